@@ -21,16 +21,25 @@
 //
 
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstdarg>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
-#include <map>
+#include <sstream>
 #include <algorithm>
 
 #include "autodgs.h"
 #include "airport.h"
 #include "plane.h"
 #include "simbrief.h"
+#include "scheduler.h"
+#include "instance_pool.h"
+#include "stand_cfg_store.h"
+#include "file_writer.h"
+#ifdef ADGS_ALLOC_COUNT
+#include "alloc_count.h"
+#endif
 
 #include "XPLMGraphics.h"
 
@@ -57,50 +66,88 @@ static constexpr float kVdgsDefaultDist = 15.0;  // m
 static constexpr float kMarshallerDefaultDist = 25.0;
 static constexpr float kVdgsDefaultHeight = 5.0;  // m AGL
 
-static constexpr float kDgsMinDist = 8.0;
-static constexpr float kDgsMaxDist = 30.0;
 static constexpr float kDgsMoveDeltaMin = 1.0;  // min/max for 'move closer' cmd
 static constexpr float kDgsMoveDeltaMax = 3.0;
 
+static constexpr float kGridCell = 50.0;            // m, cell size of the stand grid
+static constexpr float kDepartureHashCell = 2.0;    // m, cell size of the departure stand hash
+static constexpr float kDepartureStandDist = 1.0;   // m, max distance of nose wheel to a departure stand
+static constexpr float kDepartureHashMargin = 1.0;  // m, covers the x/z error of a stand that is not probed yet
+static constexpr float kWatchMoveDist = 0.2;        // m, movement that wakes up the departure job while idle
+static constexpr float kNearestStandPeriod = 0.5;   // s, loop delay while looking for a stand
+static constexpr float kTrackMinDelay = 0.02;       // s, limits for the loop delay while tracking
+static constexpr float kTrackMaxDelay = 0.2;
+
+static constexpr float kDepartureStandPeriod = 2.0; // s, periods of scheduler jobs
+static constexpr float kOfpPeriod = 5.0;
+static constexpr float kDgsLogPeriod = 2.0;
+static constexpr float kStreamPeriod = 1.0;
+static constexpr float kStreamIdlePeriod = 5.0;     // s, the camera has not moved since the last pass
+
+// instance streaming
+static constexpr float kStreamHysteresis = 300.0;   // m, instances are destroyed beyond stream_radius + this
+static constexpr int kStreamBudget = 4;             // max # of stands that get instances per frame
+
+static constexpr int kBuildBudget = 1000;           // µs per frame for placing stands during construction
+static constexpr int kProbeBudget = 4;              // max # of stands per frame that get their terrain probed
+
+static constexpr float kReOriginMinSpread = 50.0;   // m, min distance of the 3rd anchor to the line of the others
+static constexpr float kReprobeRadius = 300.0;      // m, stands closer to the plane are probed again on a shift
+static constexpr float kGeoCacheTolerance = 0.1;    // m, max deviation of a cached elevation from the terrain
+
+static constexpr float kPredictWindow = 1.0;        // s, samples considered for the fit
+static constexpr float kPredictHorizon = 0.5;       // s, max extrapolation beyond the last sample
+
+// forward corridor for FindNearestStand
+static constexpr float kCorridorTime = 10.0;        // s, length in terms of ground speed ...
+static constexpr float kCorridorMinLen = 50.0;      // m, ... but within these limits
+static constexpr float kCorridorMaxLen = 300.0;
+static constexpr float kCorridorBack = 30.0;        // m, stands further behind the nose wheel are dropped
+static constexpr float kCorridorTurn = 30.0;        // °, reseed on heading changes beyond
+
 static bool marshaller_pe_dist_updated;  // according to pilot's eye AGL
 static float marshaller_pe_dist = kMarshallerDefaultDist;
 
 static std::unique_ptr<Ofp> ofp;
 static int ofp_seqno;
-static float ofp_ts;
 
 static std::string ofp_destination;
 static std::string ofp_arrival_stand;
 
-class Marshaller;
-
-// there is exactly none or one Marshaller
-static std::unique_ptr<Marshaller> marshaller;
-
 #define SQR(x) ((x) * (x))
 
+// There is exactly one Marshaller. It holds an instance of the pool only while it is shown.
 class Marshaller {
     XPLMInstanceRef inst_ref_;
+    PushCache pushed_;
     float drefs_[DGS_DR_NUM];
 
   public:
-    Marshaller();
-    ~Marshaller();
-    void SetPos(const XPLMDrawInfo_t *drawinfo, int status, int track, int lr, float distance);
-    void SetPos(const XPLMDrawInfo_t *drawinfo);    // move to new position only
+    Marshaller() : inst_ref_(nullptr) {}
+    bool active() const { return inst_ref_ != nullptr; }
+    void Release();     // hide it, back to the pool
+
+    void SetPos(const XPLMDrawInfo_t *drawinfo, int status, int track, int lr, float distance);  // shows it
+    void SetPos(const XPLMDrawInfo_t *drawinfo);    // move to new position only, if shown
 };
 
+static Marshaller marshaller;
+
 //------------------------------------------------------------------------------------
-Marshaller::Marshaller() {
-    inst_ref_ = XPLMCreateInstance(dgs_obj[kMarshaller], dgs_dlist_dr);
-}
+void Marshaller::Release() {
+    if (inst_ref_ == nullptr)
+        return;
 
-Marshaller::~Marshaller() {
-    if (inst_ref_)
-        XPLMDestroyInstance(inst_ref_);
+    dgs_pool[kMarshaller].Release(inst_ref_);
+    inst_ref_ = nullptr;
 }
 
 void Marshaller::SetPos(const XPLMDrawInfo_t* drawinfo, int status, int track, int lr, float distance) {
+    if (inst_ref_ == nullptr) {
+        inst_ref_ = dgs_pool[kMarshaller].Acquire();
+        pushed_.Invalidate();
+    }
+
     memset(drefs_, 0, sizeof(drefs_));
     drefs_[DGS_DR_STATUS] = status;
     drefs_[DGS_DR_DISTANCE] = distance;
@@ -110,26 +157,83 @@ void Marshaller::SetPos(const XPLMDrawInfo_t* drawinfo, int status, int track, i
 }
 
 void Marshaller::SetPos(const XPLMDrawInfo_t* drawinfo) {
-    XPLMInstanceSetPosition(inst_ref_, drawinfo, drefs_);
+    if (inst_ref_)
+        pushed_.SetPosition(inst_ref_, drawinfo, drefs_);
+}
+
+//------------------------------------------------------------------------------------
+void MotionPredictor::AddSample(float t, float z, float x) {
+    t_[head_] = t;
+    z_[head_] = z;
+    x_[head_] = x;
+    head_ = (head_ + 1) % kN;
+    n_ = std::min(n_ + 1, kN);
+
+    // fit over the samples within the window
+    float t_mean = 0.0f, z_mean = 0.0f, x_mean = 0.0f;
+    int n = 0;
+    for (int i = 0; i < n_; i++)
+        if (t - t_[i] <= kPredictWindow) {
+            t_mean += t_[i];
+            z_mean += z_[i];
+            x_mean += x_[i];
+            n++;
+        }
+
+    t_mean /= n;
+    z_mean /= n;
+    x_mean /= n;
+
+    float stt = 0.0f, stz = 0.0f, stx = 0.0f;
+    for (int i = 0; i < n_; i++)
+        if (t - t_[i] <= kPredictWindow) {
+            float dt = t_[i] - t_mean;
+            stt += dt * dt;
+            stz += dt * (z_[i] - z_mean);
+            stx += dt * (x_[i] - x_mean);
+        }
+
+    valid_ = (n >= 3 && stt > 1.0E-4f);
+    if (!valid_)
+        return;
+
+    t0_ = t_mean;
+    z0_ = z_mean;
+    x0_ = x_mean;
+    vz_ = stz / stt;
+    vx_ = stx / stt;
+}
+
+std::tuple<float, float> MotionPredictor::Predict(float t) const {
+    // don't go too far beyond the last sample
+    float t_last = t_[(head_ + kN - 1) % kN];
+    t = std::min(t, t_last + kPredictHorizon);
+    return std::make_tuple(z0_ + vz_ * (t - t0_), x0_ + vx_ * (t - t0_));
 }
 
 //------------------------------------------------------------------------------------
-ScrollTxt::ScrollTxt(const std::string& txt) {
-    txt_ = txt;
+void ScrollTxt::Set(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(txt_, sizeof(txt_), fmt, ap);
+    va_end(ap);
+    len_ = std::clamp(n, 0, kMaxLen - 1);
+
     dr_scroll_ = 10;  // right most
+    memset(chars_, 0, sizeof(chars_));
     chars_[kR1Nchar - 1] = txt_[0];
     char_pos_ = 0;
 }
 
 void ScrollTxt::Tick(float* drefs) {
-    if (txt_.size() == 0)
+    if (len_ == 0)
         return;
 
     dr_scroll_ -= 2;
     if (dr_scroll_ < 0) {
         dr_scroll_ = 10;
         char_pos_++;
-        if (char_pos_ >= (int)txt_.size())
+        if (char_pos_ >= len_)
             char_pos_ = 0;
 
         for (int i = 1; i < kR1Nchar; i++)
@@ -143,99 +247,118 @@ void ScrollTxt::Tick(float* drefs) {
 };
 
 //------------------------------------------------------------------------------------
-Stand::Stand(const AptStand& as, float elevation, int dgs_type, float dgs_dist) : as_(as) {
+Stand::Stand(const AptStand& as, StandRender& r, float elevation, int dgs_type, float dgs_dist) : as_(as), r_(r) {
     // create display name
     // a stand name can be anything between "1" and "Gate A 40 (Class C, Terminal 3)"
     // we try to extract the net name "A 40" in the latter case
     const std::string& asn = as_.name;
 
     if (asn.starts_with("Stand"))
-        display_name_ = asn.substr(5);
+        r_.display_name = asn.substr(5);
     else if (asn.starts_with("Gate"))
-        display_name_ = asn.substr(4);
+        r_.display_name = asn.substr(4);
     else if (asn.starts_with("Ramp"))
-        display_name_ = asn.substr(4);
+        r_.display_name = asn.substr(4);
     else
-        display_name_ = as_.name;
+        r_.display_name = as_.name;
 
     // trim leading whitespace
-    display_name_.erase(0, display_name_.find_first_not_of(" "));
+    r_.display_name.erase(0, r_.display_name.find_first_not_of(" "));
 
     // delete stuff following and including a "({,;"
-    if (display_name_.length() > kR1Nchar) {
-        const auto i = display_name_.find_first_of("({,;");
+    if (r_.display_name.length() > kR1Nchar) {
+        const auto i = r_.display_name.find_first_of("({,;");
         if (i != std::string::npos)
-            display_name_.resize(i);
+            r_.display_name.resize(i);
     }
 
     // trim trailing whitespace
-    display_name_.erase(display_name_.find_last_not_of(" ") + 1);
+    r_.display_name.erase(r_.display_name.find_last_not_of(" ") + 1);
 
-    if (display_name_.length() > kR1Nchar)
-        display_name_.clear();  // give up
+    if (r_.display_name.length() > kR1Nchar)
+        r_.display_name.clear();  // give up
 
     elevation_ = elevation;
     sin_hdgt_ = sinf(kD2R * as_.hdgt);
     cos_hdgt_ = cosf(kD2R * as_.hdgt);
-    drawinfo_.structSize = sizeof(drawinfo_);
-    drawinfo_.heading = as_.hdgt;
-    drawinfo_.pitch = drawinfo_.roll = 0.0f;
-    vdgs_inst_ref_ = nullptr;
-    pole_base_inst_ref_ = nullptr;
+    r_.drawinfo.structSize = sizeof(r_.drawinfo);
+    r_.drawinfo.heading = as_.hdgt;
+    r_.drawinfo.pitch = r_.drawinfo.roll = 0.0f;
+    r_.vdgs_inst_ref = nullptr;
+    r_.pole_base_inst_ref = nullptr;
+    in_range_ = false;      // instances are created by the streaming
 
     marshaller_max_dist_ = kDgsMaxDist;
 
     dgs_dist_ = dgs_dist;
 
-    // determine local coords
-    ref_gen_ = -1;  // force update
-    UpdateXYZ();
-
-    dgs_type_ = -1;  // invalidate to ensure that SetDgsType's code does something
-    SetDgsType(dgs_type);
+    // local coords are determined later by SetDgsDist(), see Airport::BuildStands()
+    ref_gen_ = -1;
+    probed_ = terrain_known_ = probe_queued_ = false;
+    r_.from_cache = r_.geo_dirty = false;
+    r_.geo_dgs_dist = -1.0f;
+    r_.geo_dgs_dy = 0.0f;
+    is_wet_ = false;
+    if (dgs_type == kAutomatic)
+        dgs_type = as_.has_jw ? kVDGS : kMarshaller;
+    dgs_type_ = dgs_type;
 
     // LogMsg("Stand '%s', disp: '%s', is_wet: %d, type: %d, dgs_dist: %0.1f constructed", cname(),
-    // display_name_.c_str(),
+    // r_.display_name.c_str(),
     //        is_wet_, dgs_type_, dgs_dist_);
 }
 
 Stand::~Stand() {
-    if (vdgs_inst_ref_)
-        XPLMDestroyInstance(vdgs_inst_ref_);
-    if (pole_base_inst_ref_)
-        XPLMDestroyInstance(pole_base_inst_ref_);
+    Stream(false);
 }
 
-// set x_, y_, z_, drawinfo_ from as_.lon, as_.lat in the current reference frame
+// set x_, y_, z_, r_.drawinfo from as_.lon, as_.lat in the current reference frame
 void Stand::UpdateXYZ() {
     XPLMProbeInfo_t probeinfo = {.structSize = sizeof(XPLMProbeInfo_t)};
 
-    if (ref_gen_ != ref_gen) {
+    if (ref_gen_ != ref_gen || !probed_) {
         ref_gen_ = ref_gen;
+        probed_ = terrain_known_ = true;
         double x, y, z, lat, lon;
         XPLMWorldToLocal(as_.lat, as_.lon, elevation_, &x, &y, &z);
 
         if (xplm_ProbeHitTerrain != XPLMProbeTerrainXYZ(probe_ref, x, y, z, &probeinfo))
             throw std::runtime_error("XPLMProbeTerrainXYZ 1 failed");
 
-        // On the first pass elevation is only an estimate so we iterate.
-        // It makes a difference on higher elevation airports like LOWI.
-        XPLMLocalToWorld(probeinfo.locationX, probeinfo.locationY, probeinfo.locationZ, &lat, &lon, &elevation_);
-        XPLMWorldToLocal(as_.lat, as_.lon, elevation_, &x, &y, &z);
+        // a cached elevation that the terrain confirms saves the iteration and the DGS probe
+        bool verified = r_.from_cache && fabsf(probeinfo.locationY - (float)y) < kGeoCacheTolerance;
+        r_.from_cache = false;
 
-        if (xplm_ProbeHitTerrain != XPLMProbeTerrainXYZ(probe_ref, x, y, z, &probeinfo))
-            throw std::runtime_error("XPLMProbeTerrainXYZ 1a failed");
+        if (!verified) {
+            // On the first pass elevation is only an estimate so we iterate.
+            // It makes a difference on higher elevation airports like LOWI.
+            XPLMLocalToWorld(probeinfo.locationX, probeinfo.locationY, probeinfo.locationZ, &lat, &lon, &elevation_);
+            XPLMWorldToLocal(as_.lat, as_.lon, elevation_, &x, &y, &z);
+
+            if (xplm_ProbeHitTerrain != XPLMProbeTerrainXYZ(probe_ref, x, y, z, &probeinfo))
+                throw std::runtime_error("XPLMProbeTerrainXYZ 1a failed");
+
+            r_.geo_dirty = true;
+            r_.geo_dgs_dist = -1.0f;
+        }
 
         is_wet_ = probeinfo.is_wet;
         x_ = probeinfo.locationX;
         y_ = probeinfo.locationY;
         z_ = probeinfo.locationZ;
-        drawinfo_dgs_dist_ = -1.0f;  // force update
+        r_.drawinfo_dgs_dist = -1.0f;  // force update
+    }
+
+    if (r_.drawinfo_dgs_dist != dgs_dist_ && r_.geo_dgs_dist == dgs_dist_) {
+        r_.drawinfo_dgs_dist = dgs_dist_;
+        r_.drawinfo.x = x_ + -sin_hdgt_ * (-dgs_dist_);
+        r_.drawinfo.y = y_ + r_.geo_dgs_dy;
+        r_.drawinfo.z = z_ +  cos_hdgt_ * (-dgs_dist_);
     }
 
-    // change of dgs_dist_ requires update of drawinfo_
-    if (drawinfo_dgs_dist_ != dgs_dist_) {
-        drawinfo_dgs_dist_ = dgs_dist_;
+    // change of dgs_dist_ requires update of r_.drawinfo
+    if (r_.drawinfo_dgs_dist != dgs_dist_) {
+        r_.drawinfo_dgs_dist = dgs_dist_;
 
         // xform vector (0, -dgs_dist) into global frame
         float x = x_ + -sin_hdgt_ * (-dgs_dist_);
@@ -244,12 +367,32 @@ void Stand::UpdateXYZ() {
         if (xplm_ProbeHitTerrain != XPLMProbeTerrainXYZ(probe_ref, x, y_, z, &probeinfo))
             throw std::runtime_error("XPLMProbeTerrainXYZ 2 failed");
 
-        drawinfo_.x = probeinfo.locationX;
-        drawinfo_.y = probeinfo.locationY;
-        drawinfo_.z = probeinfo.locationZ;
+        r_.drawinfo.x = probeinfo.locationX;
+        r_.drawinfo.y = probeinfo.locationY;
+        r_.drawinfo.z = probeinfo.locationZ;
+
+        r_.geo_dirty = true;
+        r_.geo_dgs_dist = dgs_dist_;
+        r_.geo_dgs_dy = r_.drawinfo.y - y_;
     }
 }
 
+// place the stand at the elevation known so far, UpdateXYZ() probes the terrain later
+void Stand::Place() {
+    double x, y, z;
+    XPLMWorldToLocal(as_.lat, as_.lon, elevation_, &x, &y, &z);
+    ref_gen_ = ref_gen;
+    probed_ = false;
+    x_ = x;
+    y_ = y;
+    z_ = z;
+
+    r_.drawinfo_dgs_dist = dgs_dist_;
+    r_.drawinfo.x = x_ + -sin_hdgt_ * (-dgs_dist_);
+    r_.drawinfo.y = y_ + (r_.geo_dgs_dist == dgs_dist_ ? r_.geo_dgs_dy : 0.0f);
+    r_.drawinfo.z = z_ +  cos_hdgt_ * (-dgs_dist_);
+}
+
 void Stand::SetDgsType(int dgs_type) {
     LogMsg("Stand::SetDgsType: Stand '%s', type: %d, new_type: %d", cname(), dgs_type_, dgs_type);
 
@@ -262,22 +405,35 @@ void Stand::SetDgsType(int dgs_type) {
     dgs_type_ = dgs_type;
 
     if (dgs_type_ == kMarshaller) {
-        if (vdgs_inst_ref_)
-            XPLMDestroyInstance(vdgs_inst_ref_);
-        vdgs_inst_ref_ = nullptr;
-
-        if (pole_base_inst_ref_)
-            XPLMDestroyInstance(pole_base_inst_ref_);
-        pole_base_inst_ref_ = nullptr;
-
+        Stream(in_range_);  // releases the instances
         SetDgsDist();
     } else {
-        static const char* null_dlist[] = {nullptr};
-        marshaller = nullptr;
-        vdgs_inst_ref_ = XPLMCreateInstance(dgs_obj[kVDGS], dgs_dlist_dr);
-        pole_base_inst_ref_ = XPLMCreateInstance(pole_base_obj, null_dlist);
+        marshaller.Release();
         SetDgsDist();
+        if (in_range_) {
+            in_range_ = false;  // force creation
+            Stream(true);
+        }
+    }
+}
+
+void Stand::Stream(bool in_range) {
+    in_range_ = in_range;
+    if (in_range_ && dgs_type_ == kVDGS) {
+        if (r_.vdgs_inst_ref)
+            return;
+
+        r_.vdgs_inst_ref = dgs_pool[kVDGS].Acquire();
+        r_.pole_base_inst_ref = pole_base_pool.Acquire();
+        r_.vdgs_pushed.Invalidate();
+        r_.pole_base_pushed.Invalidate();
+        UpdateXYZ();
+        r_.pole_base_pushed.SetPosition(r_.pole_base_inst_ref, &r_.drawinfo, nullptr);
         SetIdle();
+    } else if (r_.vdgs_inst_ref) {
+        dgs_pool[kVDGS].Release(r_.vdgs_inst_ref);
+        pole_base_pool.Release(r_.pole_base_inst_ref);
+        r_.vdgs_inst_ref = r_.pole_base_inst_ref = nullptr;
     }
 }
 
@@ -287,7 +443,7 @@ void Stand::CycleDgsType() {
 }
 
 void Stand::SetState(int status, int track, int lr, float xtrack, float distance, bool slow) {
-    assert(dgs_type_ == kVDGS);
+    assert(dgs_type_ == kVDGS && r_.vdgs_inst_ref);
 
     int d_0 = 0;
     int d_01 = 0;
@@ -304,45 +460,45 @@ void Stand::SetState(int status, int track, int lr, float xtrack, float distance
 
     distance = ((float)((int)((distance) * 2))) / 2;  // multiple of 0.5m
 
-    memset(drefs_, 0, sizeof(drefs_));
-    drefs_[DGS_DR_STATUS] = status;
-    drefs_[DGS_DR_TRACK] = track;
-    drefs_[DGS_DR_DISTANCE] = distance;
-    drefs_[DGS_DR_DISTANCE_0] = d_0;
-    drefs_[DGS_DR_DISTANCE_01] = d_01;
-    drefs_[DGS_DR_XTRACK] = xtrack;
-    drefs_[DGS_DR_LR] = lr;
+    memset(r_.drefs, 0, sizeof(r_.drefs));
+    r_.drefs[DGS_DR_STATUS] = status;
+    r_.drefs[DGS_DR_TRACK] = track;
+    r_.drefs[DGS_DR_DISTANCE] = distance;
+    r_.drefs[DGS_DR_DISTANCE_0] = d_0;
+    r_.drefs[DGS_DR_DISTANCE_01] = d_01;
+    r_.drefs[DGS_DR_XTRACK] = xtrack;
+    r_.drefs[DGS_DR_LR] = lr;
 
     if (slow) {
-        drefs_[DGS_DR_ICAO_0] = 'S';
-        drefs_[DGS_DR_ICAO_1] = 'L';
-        drefs_[DGS_DR_ICAO_2] = 'O';
-        drefs_[DGS_DR_ICAO_3] = 'W';
+        r_.drefs[DGS_DR_ICAO_0] = 'S';
+        r_.drefs[DGS_DR_ICAO_1] = 'L';
+        r_.drefs[DGS_DR_ICAO_2] = 'O';
+        r_.drefs[DGS_DR_ICAO_3] = 'W';
     } else
         for (int i = 0; i < 4; i++)
-            drefs_[DGS_DR_ICAO_0 + i] = (int)plane.acf_icao[i];
+            r_.drefs[DGS_DR_ICAO_0 + i] = (int)plane.acf_icao[i];
 
-    const float y_0 = drawinfo_.y;
-    drawinfo_.y += kVdgsDefaultHeight;
-    XPLMInstanceSetPosition(vdgs_inst_ref_, &drawinfo_, drefs_);
-    drawinfo_.y = y_0;
+    const float y_0 = r_.drawinfo.y;
+    r_.drawinfo.y += kVdgsDefaultHeight;
+    r_.vdgs_pushed.SetPosition(r_.vdgs_inst_ref, &r_.drawinfo, r_.drefs);
+    r_.drawinfo.y = y_0;
 }
 
-float Stand::SetState(int pax_no) {
-    assert(dgs_type_ == kVDGS);
+float Stand::SetState(int pax_no, ScrollTxt& scroll_txt) {
+    assert(dgs_type_ == kVDGS && r_.vdgs_inst_ref);
 
     float delay = 1.0f;
 
-    memset(drefs_, 0, sizeof(drefs_));
+    memset(r_.drefs, 0, sizeof(r_.drefs));
 
-    if (scroll_txt_) {
-        scroll_txt_->Tick(drefs_);
+    if (scroll_txt.active()) {
+        scroll_txt.Tick(r_.drefs);
         delay = 0.05f;
     } else {
-        int n = display_name_.length();
+        int n = r_.display_name.length();
         for (int i = 0; i < n; i++)
-            drefs_[DGS_DR_R1C0 + i] = display_name_[i];
-        drefs_[DGS_DR_R1_SCROLL] = (5 * 16 - (n * 12 - 2)) / 2;  // center
+            r_.drefs[DGS_DR_R1C0 + i] = r_.display_name[i];
+        r_.drefs[DGS_DR_R1_SCROLL] = (5 * 16 - (n * 12 - 2)) / 2;  // center
     }
 
     if (pax_no > 0) {
@@ -353,37 +509,35 @@ float Stand::SetState(int pax_no) {
             if (pax_no == 0)
                 break;
         }
-        drefs_[DGS_DR_BOARDING] = 1;
+        r_.drefs[DGS_DR_BOARDING] = 1;
         for (int i = 0; i < 3; i++)
-            drefs_[DGS_DR_PAXNO_0 + i] = pn[i];
+            r_.drefs[DGS_DR_PAXNO_0 + i] = pn[i];
     }
 
-    const float y_0 = drawinfo_.y;
-    drawinfo_.y += kVdgsDefaultHeight;
-    XPLMInstanceSetPosition(vdgs_inst_ref_, &drawinfo_, drefs_);
-    drawinfo_.y = y_0;
+    const float y_0 = r_.drawinfo.y;
+    r_.drawinfo.y += kVdgsDefaultHeight;
+    r_.vdgs_pushed.SetPosition(r_.vdgs_inst_ref, &r_.drawinfo, r_.drefs);
+    r_.drawinfo.y = y_0;
     return delay;
 }
 
 void Stand::SetIdle() {
-    if (vdgs_inst_ref_ == nullptr)
+    if (r_.vdgs_inst_ref == nullptr)
         return;
 
     LogMsg("SetIdle stand: '%s'", cname());
 
-    scroll_txt_ = nullptr;
-
-    memset(drefs_, 0, sizeof(drefs_));
+    memset(r_.drefs, 0, sizeof(r_.drefs));
 
-    int n = display_name_.length();
+    int n = r_.display_name.length();
     for (int i = 0; i < n; i++)
-        drefs_[DGS_DR_R1C0 + i] = display_name_[i];
-    drefs_[DGS_DR_R1_SCROLL] = (5 * 16 - (n * 12 - 2)) / 2;  // center
+        r_.drefs[DGS_DR_R1C0 + i] = r_.display_name[i];
+    r_.drefs[DGS_DR_R1_SCROLL] = (5 * 16 - (n * 12 - 2)) / 2;  // center
 
-    const float y_0 = drawinfo_.y;
-    drawinfo_.y += kVdgsDefaultHeight;
-    XPLMInstanceSetPosition(vdgs_inst_ref_, &drawinfo_, drefs_);
-    drawinfo_.y = y_0;
+    const float y_0 = r_.drawinfo.y;
+    r_.drawinfo.y += kVdgsDefaultHeight;
+    r_.vdgs_pushed.SetPosition(r_.vdgs_inst_ref, &r_.drawinfo, r_.drefs);
+    r_.drawinfo.y = y_0;
 }
 
 // compute the DGS position
@@ -418,10 +572,8 @@ void Stand::SetDgsDist() {
 
     UpdateXYZ();
 
-    if (dgs_type_ == kVDGS) {
-        assert(pole_base_inst_ref_ != nullptr);
-        XPLMInstanceSetPosition(pole_base_inst_ref_, &drawinfo_, nullptr);
-    }
+    if (dgs_type_ == kVDGS && r_.pole_base_inst_ref)
+        r_.pole_base_pushed.SetPosition(r_.pole_base_inst_ref, &r_.drawinfo, nullptr);
 }
 
 // adjust may be negative to move it closer
@@ -439,7 +591,26 @@ void Stand::DgsMoveCloser() {
 const char* const Airport::state_str[] = {"INACTIVE", "DEPARTURE", "BOARDING", "ARRIVAL", "ENGAGED", "TRACK",
                                           "GOOD",     "BAD",       "PARKED",   "CHOCKS",  "DONE"};
 
-void LoadCfg(const std::string& pathname, std::unordered_map<std::string, std::tuple<int, float>>& cfg);
+// FNV-1a over the apt.dat data of the stands, any change of the airport's layout invalidates the cache
+static uint64_t GeoFingerprint(const AptAirport& apt_airport) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto hash = [&h](const void* p, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            h ^= static_cast<const uint8_t*>(p)[i];
+            h *= 0x100000001b3ULL;
+        }
+    };
+
+    for (auto const& as : apt_airport.stands_) {
+        hash(as.name.data(), as.name.size());
+        hash(&as.lat, sizeof(as.lat));
+        hash(&as.lon, sizeof(as.lon));
+        hash(&as.hdgt, sizeof(as.hdgt));
+        hash(&as.has_jw, sizeof(as.has_jw));
+    }
+
+    return h;
+}
 
 Airport::Airport(const AptAirport& apt_airport) {
     CheckRefFrameShift();   // ensure ref_gen is up to date
@@ -449,113 +620,249 @@ Airport::Airport(const AptAirport& apt_airport) {
     stands_.reserve(apt_airport.stands_.size());
     float arpt_elevation = XPLMGetDataf(plane_elevation_dr);  // best guess
 
-    std::unordered_map<std::string, std::tuple<int, float>> cfg;
-    LoadCfg(user_cfg_dir + name() + ".cfg", cfg);
-    if (cfg.empty())
-        LoadCfg(sys_cfg_dir + name() + ".cfg", cfg);
-
-    for (auto const& as : apt_airport.stands_) {
-        int dgs_type = kAutomatic;
-        float dgs_dist;
-        if (as.has_jw)
-            dgs_dist = kVdgsDefaultDist;
-        else
-            dgs_dist = kMarshallerDefaultDist;
-
-        // override with user defined config
-        if (const auto it = cfg.find(as.name); it != cfg.end()) {
-            std::tie(dgs_type, dgs_dist) = it->second;
-            LogMsg("found in config '%s', %d, %0.1f", as.name.c_str(), dgs_type, dgs_dist);
-        }
+    // dgs_type, dgs_dist per stand, defaults overridden by the user or system config
+    std::vector<std::tuple<int, float>> cfg;
+    cfg.reserve(apt_airport.stands_.size());
+    for (auto const& as : apt_airport.stands_)
+        cfg.emplace_back(kAutomatic, as.has_jw ? kVdgsDefaultDist : kMarshallerDefaultDist);
+
+    // a later entry wins
+    std::vector<StandCfg> cfg_entries;
+    stand_cfg_store.Lookup(name(), cfg_entries);
+    for (auto const& c : cfg_entries) {
+        auto [first, last] = apt_airport.FindStands(c.name);
+        if (first < last)
+            LogMsg("found in config '%s', %d, %0.1f", c.name.c_str(), c.dgs_type, c.dgs_dist);
+        for (int i = first; i < last; i++)
+            cfg[i] = std::make_tuple(c.dgs_type, c.dgs_dist);
+    }
 
-        stands_.emplace_back(as, arpt_elevation, dgs_type, dgs_dist);
+    // the Stands refer to their StandRender, so render_ must not reallocate later
+    render_.resize(apt_airport.stands_.size());
+    for (int i = 0; i < (int)apt_airport.stands_.size(); i++) {
+        auto [dgs_type, dgs_dist] = cfg[i];
+        stands_.emplace_back(apt_airport.stands_[i], render_[i], arpt_elevation, dgs_type, dgs_dist);
     }
 
+    // the geo cache is read on the file writer thread and applied by BuildStands()
+    geo_fingerprint_ = GeoFingerprint(apt_airport);
+    file_writer.Read(user_cfg_dir + name() + ".geo");
+    geo_cache_pending_ = true;
+
+    // placing the stands in the local frame is spread over several frames,
+    // nearest first so the stands that matter now are available right away
+    const fem::LLPos plane_pos(XPLMGetDataf(plane_lat_dr), XPLMGetDataf(plane_lon_dr));
+    std::vector<std::tuple<float, int>> by_dist;
+    by_dist.reserve(stands_.size());
+    for (int i = 0; i < (int)stands_.size(); i++)
+        by_dist.emplace_back(fem::len(fem::LLPos(stands_[i].lat(), stands_[i].lon()) - plane_pos), i);
+    std::sort(by_dist.begin(), by_dist.end());
+
+    probe_queue_.reserve(stands_.size());
+    build_order_.reserve(stands_.size());
+    for (auto [d, i] : by_dist)
+        build_order_.push_back(i);
+    build_next_ = 0;
+
     state_ = INACTIVE;
     active_stand_ = selected_stand_ = departure_stand_ = -1;
     user_cfg_changed_ = false;
 
     timestamp_ = distance_ = sin_wave_prev_ = 0.0f;
-    departure_stand_ts_ = nearest_stand_ts_ = update_dgs_log_ts_ = 0.0f;
+    arrival_runs_ = 0;
+    arrival_fixed_runs_ = arrival_fixed_delay_ = arrival_ts_ = 0.0f;
+
+    slow_ = dgs_log_due_ = false;
+    display_d_ = display_x_ = 0;
+    corridor_ts_ = 0.0f;
+    corridor_x_ = corridor_z_ = corridor_hdgt_ = corridor_len_ = corridor_back_ = 0.0f;
 
     if (ofp_destination == name_) {
         LogMsg("Now on the OFP destination '%s', looking for arrival stand %s", ofp_destination.c_str(), ofp_arrival_stand.c_str());
-        for (int i = 0; i < (int)stands_.size(); i++) {
-            if (stands_[i].name() == ofp_arrival_stand) {
-                selected_stand_ = i;
-                LogMsg("found");
-                break;
-            }
+        // stands_ are in the order of apt_airport.stands_, on duplicates take the first
+        auto [first, last] = apt_airport.FindStands(ofp_arrival_stand);
+        if (first < last) {
+            selected_stand_ = first;
+            LogMsg("found");
         }
 
         if (selected_stand_ == -1)
             LogMsg("Arrival stand '%s' from OFP not found", ofp_arrival_stand.c_str());
     }
+
+#ifdef ADGS_ALLOC_COUNT
+    state_machine_job_ = scheduler.Add("state machine", 1.0f, 0.0f, [this]() {
+        state_t state = state_;
+        int gen = ref_gen_;
+        uint64_t n_alloc = AllocCount();
+        float delay = StateMachine();
+        // steady state TRACK and BOARDING must not allocate,
+        // a reference frame shift rebuilds the grid and the departure hash and is exempt
+        assert(!((state == TRACK || state == BOARDING) && state_ == state && ref_gen_ == gen &&
+                 AllocCount() != n_alloc));
+        return delay;
+    });
+#else
+    state_machine_job_ = scheduler.Add("state machine", 1.0f, 0.0f, [this]() { return StateMachine(); });
+#endif
+    watch_pos_ = plane_pos;
+    watch_beacon_ = -1;
+    departure_job_ = scheduler.Add("departure stand", 0.1f, kDepartureStandPeriod, [this]() { return DepartureJob(); });
+    // these sleep while there is nothing to do for them and are woken up by state transitions
+    ofp_job_ = scheduler.Add("ofp", 1.0f, -1.0f, [this]() {
+        OfpJob();
+        return (state_ == DEPARTURE || state_ == BOARDING) ? kOfpPeriod : 0.0f;
+    });
+    dgs_log_job_ = scheduler.Add("dgs log", 0.1f, -1.0f, [this]() {
+        dgs_log_due_ = true;
+        return state_ > ARRIVAL ? kDgsLogPeriod : 0.0f;
+    });
+    display_job_ = scheduler.Add("display", 0.1f, -1.0f, [this]() { return UpdateDisplay(); });
+    stream_view_x_ = stream_view_z_ = 0.0f;
+    stream_radius_ = stream_radius;
+    stream_due_ = true;
+    stream_job_ = scheduler.Add("stream", 0.5f, 0.0f, [this]() { return StreamJob(); });
+    build_job_ = scheduler.Add("build", 0.5f + kBuildBudget * 1.0E-3f, -1.0f,
+                               [this]() { return BuildStands() ? 0.0f : -1.0f; });
+    probe_job_ = scheduler.Add("probe", 1.0f, -1.0f, [this]() { return ProbeJob(); });
+
+    // the first slice right away, so if we are parked on a stand
+    // the first run of the state machine can show the departure VDGS
+    BuildGrid();            // empty, the stands are added as they are placed
+    if (!BuildStands())
+        scheduler.Schedule(build_job_, 0.0f);
+
+    int dsi = FindDepartureStand(Snapshot::Take());
+    if (dsi >= 0)
+        SetDepartureStand(dsi);
 }
 
 Airport::~Airport() {
+    for (int id : {state_machine_job_, departure_job_, ofp_job_, dgs_log_job_, display_job_, stream_job_, build_job_,
+                   probe_job_})
+        scheduler.Remove(id);
+
+    marshaller.Release();
     FlushUserCfg();
-    LogMsg("Airport '%s' destructed", name().c_str());
+    SaveGeoCache();
+    int n_known = std::count_if(stands_.begin(), stands_.end(), [](const Stand& s) { return s.terrain_known_; });
+    LogMsg("Airport '%s' destructed, terrain probed for %d of %d stands", name().c_str(), n_known,
+           (int)stands_.size());
 }
 
-void LoadCfg(const std::string& pathname, std::unordered_map<std::string, std::tuple<int, float>>& cfg) {
-    std::ifstream f(pathname);
-    if (f.is_open()) {
-        LogMsg("Loading config from '%s'", pathname.c_str());
+void Airport::FlushUserCfg() {
+    if (!user_cfg_changed_)
+        return;
 
-        std::string line;
-        while (std::getline(f, line)) {
-            if (line.size() == 0 || line[0] == '#')
-                continue;
+    std::string fn = user_cfg_dir + name() + ".cfg";
+    std::string content;
+    content.reserve(stands_.size() * 40);
+    content += "# type, dgs_dist, stand_name\n";
+    content += "# type = M or V, dgs_dist = dist from parking pos in m\n";
+
+    // The apt.dat spec demands that the stand names must be unique but usually they are not.
+    // stands_ are sorted by name so we write one line per name, the last entry wins.
+    std::vector<StandCfg> cfg;
+    cfg.reserve(stands_.size());
+    for (int i = 0; i < (int)stands_.size(); i++) {
+        const Stand& s = stands_[i];
+        if (i + 1 < (int)stands_.size() && stands_[i + 1].name() == s.name())
+            continue;
 
-            if (line.back() == '\r')
-                line.pop_back();
+        float dist = s.dgs_type_ == kMarshaller ? s.marshaller_max_dist_ : s.dgs_dist_;
+        cfg.push_back({s.dgs_type_ == kMarshaller ? kMarshaller : kVDGS, roundf(dist * 10.0f) / 10.0f, s.name()});
+    }
 
-            int ofs;
-            float dgs_dist;
-            char type;
-            int n = sscanf(line.c_str(), "%c,%f, %n", &type, &dgs_dist, &ofs);
-            if (n != 2 || ofs >= (int)line.size()  // distrust user input
-                || !(type == 'V' || type == 'M') || dgs_dist < kDgsMinDist || dgs_dist > kDgsMaxDist) {
-                LogMsg("invalid line: '%s' %d", line.c_str(), n);
-                continue;
-            }
+    for (auto const& c : cfg) {
+        char line[200];
+        snprintf(line, sizeof(line), "%c, %5.1f, %s\n", (c.dgs_type == kMarshaller ? 'M' : 'V'), c.dgs_dist,
+                 c.name.c_str());
+        content += line;
+    }
+
+    // the disk I/O is done in the background, a later flush of the same file replaces a pending one
+    file_writer.Write(fn, std::move(content));
+    user_cfg_changed_ = false;
+    LogMsg("cfg queued for '%s'", fn.c_str());
+    stand_cfg_store.Update(name(), cfg);    // the index picks the file up at the next start
+}
 
-            cfg[line.substr(ofs)] = std::make_tuple((type == 'M' ? kMarshaller : kVDGS), dgs_dist);
+// The cached values are used for placing the stands but are verified by a single probe
+// when the stand is probed. So a change of the mesh only costs the full set of probes.
+// Stands that were probed before the cache came in keep their values, the others are placed again.
+bool Airport::LoadGeoCache() {
+    std::string fn = user_cfg_dir + name() + ".geo";
+    std::string content;
+    if (!file_writer.Fetch(fn, content))
+        return false;
+
+    if (content.empty())
+        return true;
+
+    std::istringstream f(content);
+    std::string line;
+    unsigned long long fp;
+    if (!std::getline(f, line) || sscanf(line.c_str(), "fingerprint %llx", &fp) != 1 || fp != geo_fingerprint_) {
+        LogMsg("Geo cache '%s' is outdated, ignored", fn.c_str());
+        return true;
+    }
+
+    int n_loaded = 0;
+    while (std::getline(f, line)) {
+        int idx, is_wet;
+        double elevation;
+        float dgs_dist, dgs_dy;
+        if (sscanf(line.c_str(), "%d %lf %d %f %f", &idx, &elevation, &is_wet, &dgs_dist, &dgs_dy) != 5
+            || idx < 0 || idx >= (int)stands_.size()) {
+            LogMsg("invalid line: '%s'", line.c_str());
+            continue;
         }
+
+        Stand& s = stands_[idx];
+        if (s.terrain_known_)
+            continue;
+
+        s.elevation_ = elevation;
+        s.is_wet_ = is_wet;
+        s.r_.geo_dgs_dist = dgs_dist;
+        s.r_.geo_dgs_dy = dgs_dy;
+        s.r_.from_cache = s.terrain_known_ = true;
+        if (s.placed())
+            s.Place();
+        n_loaded++;
     }
+
+    LogMsg("Geo cache '%s' loaded for %d of %d stands", fn.c_str(), n_loaded, (int)stands_.size());
+    return true;
 }
 
-void Airport::FlushUserCfg() {
-    if (!user_cfg_changed_)
+void Airport::SaveGeoCache() {
+    if (std::none_of(render_.begin(), render_.end(), [](const StandRender& r) { return r.geo_dirty; }))
         return;
 
-    std::string fn = user_cfg_dir + name() + ".cfg";
-    std::ofstream f(fn);
-    if (!f.is_open()) {
-        LogMsg("Can't create '%s'", fn.c_str());
-        return;
-    }
+    std::string fn = user_cfg_dir + name() + ".geo";
+    std::string content;
+    content.reserve(stands_.size() * 40);
 
-    // The apt.dat spec demands that the stand names must be unique but usually they are not.
-    // Hence we build an ordered map first and write that out.
-    // Last entry wins.
-    std::map<std::string, std::string> cfg;
-    for (auto const& s : stands_) {
-        char line[200];
-        float dist = s.dgs_type_ == kMarshaller ? s.marshaller_max_dist_ : s.dgs_dist_;
-        snprintf(line, sizeof(line), "%c, %5.1f, %s\n", (s.dgs_type_ == kMarshaller ? 'M' : 'V'), dist,
-                 s.name().c_str());
-        cfg[s.name()] = line;
-    }
+    char line[200];
+    snprintf(line, sizeof(line), "fingerprint %016llx\n", (unsigned long long)geo_fingerprint_);
+    content += line;
 
-    f << "# type, dgs_dist, stand_name\n";
-    f << "# type = M or V, dgs_dist = dist from parking pos in m\n";
+    // stands that were never probed keep their estimated elevation and are not written
+    int n_written = 0;
+    for (int i = 0; i < (int)stands_.size(); i++) {
+        const Stand& s = stands_[i];
+        if (!s.terrain_known_)
+            continue;
 
-    for (auto const& kv : cfg)
-        f << kv.second;
+        snprintf(line, sizeof(line), "%d %0.3f %d %0.2f %0.3f\n", i, s.elevation_, (int)s.is_wet_, s.r_.geo_dgs_dist,
+                 s.r_.geo_dgs_dy);
+        content += line;
+        n_written++;
+    }
 
-    LogMsg("cfg written to '%s'", fn.c_str());
+    file_writer.Write(fn, std::move(content));
+    LogMsg("Geo cache for %d stands queued for '%s'", n_written, fn.c_str());
 }
 
 std::unique_ptr<Airport> Airport::LoadAirport(const std::string& icao) {
@@ -566,12 +873,10 @@ std::unique_ptr<Airport> Airport::LoadAirport(const std::string& icao) {
     return std::make_unique<Airport>(*arpt);
 }
 
-std::tuple<int, const std::string> Airport::GetStand(int idx) const {
+std::tuple<int, const std::string&> Airport::GetStand(int idx) const {
     assert(0 <= idx && idx < (int)stands_.size());
     const Stand& s = stands_[idx];
-    std::string name{s.name()};
-    int dgs_type = s.dgs_type_;
-    return std::make_tuple(dgs_type, name);
+    return {s.dgs_type_, s.name()};
 }
 
 void Airport::SetSelectedStand(int selected_stand) {
@@ -616,8 +921,16 @@ void Airport::ResetState(state_t new_state) {
     if (active_stand_ >= 0)
         stands_[active_stand_].SetIdle();
     active_stand_ = -1;
+    corridor_valid_ = false;
 
-    marshaller = nullptr;
+    if (arrival_runs_ > 0) {
+        LogMsg("arrival: %d state machine runs, the fixed schedule would have used ~%0.0f", arrival_runs_,
+               arrival_fixed_runs_);
+        arrival_runs_ = 0;
+        arrival_fixed_runs_ = 0.0f;
+    }
+
+    marshaller.Release();
     if (new_state == INACTIVE) {
         selected_stand_ = -1;
         FlushUserCfg();
@@ -625,6 +938,11 @@ void Airport::ResetState(state_t new_state) {
 
     marshaller_pe_dist_updated = false;
     marshaller_pe_dist = kMarshallerDefaultDist;
+
+    // wake up sleeping jobs
+    scheduler.Schedule(state_machine_job_, 0.0f);
+    scheduler.Schedule(departure_job_, 0.0f);
+    ScheduleStream();       // the stands that are always kept may have changed
     UpdateUI();
 }
 
@@ -635,87 +953,346 @@ void Airport::CycleDgsType() {
     }
 }
 
-void Airport::FindNearestStand() {
-    // Check if the currently active stand is also the selected stand
-    if (active_stand_ >= 0 && active_stand_ == selected_stand_)
-        return;
+static inline uint64_t DepartureHashKey(int ix, int iz) {
+    return (uint64_t)(uint32_t)ix << 32 | (uint32_t)iz;
+}
 
-    double dist = 1.0E10;
-    int min_stand = -1;
+// Place the next stands of build_order_ until the time budget is used up.
+// They are appended to the grid's tail and sorted into the cells once all are placed.
+bool Airport::BuildStands() {
+    const auto t0 = std::chrono::steady_clock::now();
+    auto budget_used = [t0]() {
+        return std::chrono::steady_clock::now() - t0 >= std::chrono::microseconds(kBuildBudget);
+    };
 
-    float plane_x = XPLMGetDataf(plane_x_dr);
-    float plane_z = XPLMGetDataf(plane_z_dr);
+    if (geo_cache_pending_ && LoadGeoCache())
+        geo_cache_pending_ = false;
 
-    float plane_hdgt = XPLMGetDataf(plane_true_psi_dr);
+    int n = 0;
+    while (build_next_ < (int)build_order_.size()) {
+        int i = build_order_[build_next_++];
+        Stand& s = stands_[i];
+        if (!s.placed()) {          // else selected before its turn, it goes into the final grid
+            s.Place();
+            AddToGrid(i);
+        }
+        n++;
 
-    if (selected_stand_ >= 0) {
-        dist = 0.0;
-        min_stand = selected_stand_;
-    } else {
-        for (int i = 0; i < (int)stands_.size(); i++) {
-            Stand& s = stands_[i];
-            if (s.is_wet_)
-                continue;
+        if (budget_used())
+            break;
+    }
 
-            // heading in local system
-            float local_hdgt = fem::RA(plane_hdgt - s.hdgt());
+    if (n > 0) {
+        corridor_valid_ = false;    // reseed with the new stands
+        ScheduleStream();
+    }
 
-            if (fabsf(local_hdgt) > 90.0f)
-                continue;  // not looking to stand
+    // the final sort gets a slice of its own unless there is time left in this one
+    if (build_next_ < (int)build_order_.size() || geo_cache_pending_ || (n > 0 && budget_used()))
+        return false;
 
-            // transform into gate local coordinate system
+    BuildGrid();
+    LogMsg("all %d stands placed", (int)stands_.size());
+    scheduler.Schedule(departure_job_, 0.0f);   // it may have gone to sleep before its stand was placed
+    build_order_ = std::vector<int>();     // release
+    build_next_ = 0;
+    return true;
+}
 
-            // xlate + rotate into stand frame
-            float dx = plane_x - s.x_;
-            float dz = plane_z - s.z_;
+// Over the extent of an airport the change of local coordinates on a shift of the reference frame
+// is affine to a good approximation. It is determined from 3 anchor stands with known lat, lon,
+// elevation and applied to all placed stands, which then are no longer marked as probed.
+// -> false if there are no suitable anchors
+bool Airport::ReOrigin() {
+    // the extremes in x and the stand farthest off the line between them
+    int a0 = -1, a1 = -1, a2 = -1;
+    for (int i = 0; i < (int)stands_.size(); i++) {
+        const Stand& s = stands_[i];
+        if (!s.placed())
+            continue;
+        if (a0 < 0 || s.x_ < stands_[a0].x_)
+            a0 = i;
+        if (a1 < 0 || s.x_ > stands_[a1].x_)
+            a1 = i;
+    }
 
-            float local_x =  s.cos_hdgt_ * dx + s.sin_hdgt_ * dz;
-            float local_z = -s.sin_hdgt_ * dx + s.cos_hdgt_ * dz;
+    if (a0 < 0 || a0 == a1)
+        return false;
 
-            // nose wheel
-            float nw_z = local_z - plane.nw_z;
-            float nw_x = local_x + plane.nw_z * sinf(kD2R * local_hdgt);
+    const float lx = stands_[a1].x_ - stands_[a0].x_;
+    const float lz = stands_[a1].z_ - stands_[a0].z_;
+    const float len = sqrtf(lx * lx + lz * lz);
+    float spread = 0.0f;
+    for (int i = 0; i < (int)stands_.size(); i++) {
+        const Stand& s = stands_[i];
+        if (!s.placed())
+            continue;
+        float d = fabsf(lx * (s.z_ - stands_[a0].z_) - lz * (s.x_ - stands_[a0].x_)) / len;
+        if (d > spread) {
+            spread = d;
+            a2 = i;
+        }
+    }
 
-            float d = sqrt(SQR(nw_x) + SQR(nw_z));
-            if (d > kCapZ + 50)  // fast exit
-                continue;
+    if (spread < kReOriginMinSpread)
+        return false;
+
+    // solve M * c = rhs with rows (x, z, 1) of M for the old and rhs from the new coordinates
+    double m[3][3], rx[3], rz[3], ry[3];
+    int k = 0;
+    for (int a : {a0, a1, a2}) {
+        const Stand& s = stands_[a];
+        double x, y, z;
+        XPLMWorldToLocal(s.lat(), s.lon(), s.elevation_, &x, &y, &z);
+        m[k][0] = s.x_;
+        m[k][1] = s.z_;
+        m[k][2] = 1.0;
+        rx[k] = x;
+        rz[k] = z;
+        ry[k] = y - s.y_;
+        k++;
+    }
 
-            // LogMsg("stand: %s, z: %2.1f, x: %2.1f", s.name(), nw_z, nw_x);
+    auto det3 = [](double a[3][3]) {
+        return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+               a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    };
+
+    // Cramer's rule
+    const double det = det3(m);
+    auto solve = [&](const double rhs[3], double c[3]) {
+        for (int j = 0; j < 3; j++) {
+            double mj[3][3];
+            for (int r = 0; r < 3; r++)
+                for (int col = 0; col < 3; col++)
+                    mj[r][col] = (col == j) ? rhs[r] : m[r][col];
+            c[j] = det3(mj) / det;
+        }
+    };
+
+    double cx[3], cz[3], cy[3];
+    solve(rx, cx);
+    solve(rz, cz);
+    solve(ry, cy);
+
+    auto xform = [&](float& x, float& y, float& z) {
+        double x_n = cx[0] * x + cx[1] * z + cx[2];
+        double z_n = cz[0] * x + cz[1] * z + cz[2];
+        y += cy[0] * x + cy[1] * z + cy[2];
+        x = x_n;
+        z = z_n;
+    };
+
+    for (auto& s : stands_) {
+        if (!s.placed())
+            continue;
+        xform(s.x_, s.y_, s.z_);
+        xform(s.r_.drawinfo.x, s.r_.drawinfo.y, s.r_.drawinfo.z);
+        s.ref_gen_ = ref_gen;
+        s.probed_ = false;
+    }
 
-            // behind
-            if (nw_z < -4.0) {
-                // LogMsg("behind: %s", s.cname());
-                continue;
-            }
+    return true;
+}
 
-            if (nw_z > 10.0) {
-                float angle = atan(nw_x / nw_z) / kD2R;
-                // LogMsg("angle to plane: %s, %3.1f", s.cname(), angle);
+void Airport::BuildGrid() {
+    float x_max, z_max;
+    grid_x0_ = grid_z0_ = 1.0E10f;
+    x_max = z_max = -1.0E10f;
+    int n_placed = 0;
+    for (auto const& s : stands_) {
+        if (!s.placed())
+            continue;
+        n_placed++;
+        grid_x0_ = std::min(grid_x0_, s.x_);
+        grid_z0_ = std::min(grid_z0_, s.z_);
+        x_max = std::max(x_max, s.x_);
+        z_max = std::max(z_max, s.z_);
+    }
 
-                // check whether plane is in a +-60° sector relative to stand
-                if (fabsf(angle) > 60.0)
-                    continue;
+    if (n_placed == 0)
+        grid_x0_ = grid_z0_ = x_max = z_max = 0.0f;
+
+    grid_nx_ = (int)((x_max - grid_x0_) / kGridCell) + 1;
+    grid_nz_ = (int)((z_max - grid_z0_) / kGridCell) + 1;
+
+    auto cell = [this](const Stand& s) {
+        return (int)((s.z_ - grid_z0_) / kGridCell) * grid_nx_ + (int)((s.x_ - grid_x0_) / kGridCell);
+    };
+
+    // counting sort of stands into cells
+    grid_start_.assign(grid_nx_ * grid_nz_ + 1, 0);
+    for (auto const& s : stands_)
+        if (s.placed())
+            grid_start_[cell(s) + 1]++;
+
+    for (int c = 0; c < grid_nx_ * grid_nz_; c++)
+        grid_start_[c + 1] += grid_start_[c];
+
+    // room for all stands, so the tail never reallocates
+    grid_stands_.reserve(stands_.size());
+    grid_stands_.resize(n_placed);
+    std::vector<int> fill(grid_start_.begin(), grid_start_.end() - 1);
+    for (int i = 0; i < (int)stands_.size(); i++)
+        if (stands_[i].placed())
+            grid_stands_[fill[cell(stands_[i])]++] = i;
+
+    soa_.Resize(stands_.size());
+    for (int j = 0; j < n_placed; j++) {
+        const Stand& s = stands_[grid_stands_[j]];
+        soa_.Set(j, s.x_, s.z_, s.hdgt(), s.sin_hdgt_, s.cos_hdgt_, !s.is_wet_);
+    }
 
-                // drive-by and beyond a +- 60° sector relative to plane's direction
-                float rel_to_stand = fem::RA(-angle - local_hdgt);
-                // LogMsg("rel_to_stand: %s, nw_x: %0.1f, local_hdgt %0.1f, rel_to_stand: %0.1f",
-                //        s.cname(), nw_x, local_hdgt, rel_to_stand);
-                if ((nw_x > 10.0 && rel_to_stand < -60.0) || (nw_x < -10.0 && rel_to_stand > 60.0)) {
-                    // LogMsg("drive by %s", s.cname());
-                    continue;
-                }
-            }
+    departure_hash_.clear();
+    for (int j = 0; j < n_placed; j++)
+        AddToDepartureHash(j);
 
-            // for the final comparison give xtrack a higher weight + consider heading deviation
-            static constexpr float xtrack_weight = 4.0;
-            d = sqrt(SQR(xtrack_weight * nw_x) + SQR(nw_z)) + fabsf(local_hdgt);
+    corridor_valid_ = false;  // indices into soa_ are no longer valid
 
-            if (d < dist) {
-                // LogMsg("new min: %s, z: %2.1f, x: %2.1f", s.cname(), nw_z, nw_x);
-                dist = d;
-                min_stand = i;
-            }
+    // the corridor can't hold more than all stands, so reseeding never allocates
+    corridor_.reserve(stands_.size());
+    corridor_soa_.Resize(stands_.size());
+    stream_candidates_.reserve(stands_.size());
+    if (n_placed > 0)
+        LogMsg("stand grid: %d x %d cells for %d of %d stands", grid_nx_, grid_nz_, n_placed, (int)stands_.size());
+}
+
+void Airport::AddToGrid(int i) {
+    const Stand& s = stands_[i];
+    const int j = grid_stands_.size();
+    grid_stands_.push_back(i);
+    soa_.Set(j, s.x_, s.z_, s.hdgt(), s.sin_hdgt_, s.cos_hdgt_, !s.is_wet_);
+    AddToDepartureHash(j);
+}
+
+// A stand goes into every cell its capture disc overlaps so a lookup is a single probe.
+// The disc is widened as a stand that is not probed yet may move a bit, see FindDepartureStand().
+void Airport::AddToDepartureHash(int j) {
+    const float r = kDepartureStandDist + kDepartureHashMargin;
+    const int ix0 = (int)floorf((soa_.x[j] - r) / kDepartureHashCell);
+    const int ix1 = (int)floorf((soa_.x[j] + r) / kDepartureHashCell);
+    const int iz0 = (int)floorf((soa_.z[j] - r) / kDepartureHashCell);
+    const int iz1 = (int)floorf((soa_.z[j] + r) / kDepartureHashCell);
+    for (int iz = iz0; iz <= iz1; iz++)
+        for (int ix = ix0; ix <= ix1; ix++)
+            departure_hash_[DepartureHashKey(ix, iz)].push_back(j);
+}
+
+// Collect the stands in a rectangle ahead of the plane that are candidates for the capture test now
+// or while the plane travels the next corridor_len_ meters without turning by more than kCorridorTurn.
+void Airport::SeedCorridor(const stand_capture::Input& in, float ground_speed) {
+    corridor_len_ = std::clamp(ground_speed * kCorridorTime, kCorridorMinLen, kCorridorMaxLen);
+    corridor_x_ = in.plane_x;
+    corridor_z_ = in.plane_z;
+    corridor_hdgt_ = in.plane_hdgt;
+    corridor_ts_ = now;
+    corridor_valid_ = true;
+
+    // in the plane's frame, the nose wheel is at most ~1.5 * nw_z away from the plane's position
+    // stands beside the plane may move to the front on a turn
+    const float radius = in.max_dist + 1.5f * fabsf(plane.nw_z);
+    const float front = radius + corridor_len_;
+    const float back = fabsf(plane.nw_z) + kCorridorBack + radius * sinf(kD2R * kCorridorTurn);
+    corridor_back_ = back;
+
+    // a path that curves by up to kCorridorTurn drifts sideways until the next seed
+    const float side = radius + corridor_len_ * sinf(kD2R * kCorridorTurn);
+
+    const float sin_h = sinf(kD2R * in.plane_hdgt);
+    const float cos_h = cosf(kD2R * in.plane_hdgt);
+
+    // bounding box of the corridor for the grid query
+    float x_min = 1.0E10f, x_max = -1.0E10f, z_min = 1.0E10f, z_max = -1.0E10f;
+    for (float f : {-back, front})
+        for (float l : {-side, side}) {
+            float x = in.plane_x + f * sin_h + l * cos_h;
+            float z = in.plane_z - f * cos_h + l * sin_h;
+            x_min = std::min(x_min, x);
+            x_max = std::max(x_max, x);
+            z_min = std::min(z_min, z);
+            z_max = std::max(z_max, z);
         }
+
+    const int ix0 = std::max(0, (int)floorf((x_min - grid_x0_) / kGridCell));
+    const int ix1 = std::min(grid_nx_ - 1, (int)floorf((x_max - grid_x0_) / kGridCell));
+    const int iz0 = std::max(0, (int)floorf((z_min - grid_z0_) / kGridCell));
+    const int iz1 = std::min(grid_nz_ - 1, (int)floorf((z_max - grid_z0_) / kGridCell));
+
+    auto consider = [&](int j) {
+        if (soa_.valid[j] < 0.5f)
+            return;
+
+        float dx = soa_.x[j] - in.plane_x;
+        float dz = soa_.z[j] - in.plane_z;
+        float f = dx * sin_h - dz * cos_h;     // forward
+        float l = dx * cos_h + dz * sin_h;     // lateral
+        if (-back <= f && f <= front && fabsf(l) <= side) {
+            corridor_.push_back(j);
+            RequestProbe(grid_stands_[j]);
+        }
+    };
+
+    corridor_.clear();
+    for (int iz = iz0; iz <= iz1 && ix0 <= ix1; iz++) {
+        const int row = iz * grid_nx_;
+        for (int j = grid_start_[row + ix0]; j < grid_start_[row + ix1 + 1]; j++)
+            consider(j);
+    }
+
+    // stands placed while the airport is built are not sorted into the cells yet
+    for (int j = grid_start_.back(); j < (int)grid_stands_.size(); j++)
+        consider(j);
+
+    corridor_soa_.Gather(soa_, corridor_);
+}
+
+// drop the stands that fell behind the plane
+void Airport::PruneCorridor(const stand_capture::Input& in) {
+    // same rear bound as the seed, so stands beside the plane survive a turn
+    const float back = corridor_back_;
+    const float sin_h = sinf(kD2R * in.plane_hdgt);
+    const float cos_h = cosf(kD2R * in.plane_hdgt);
+
+    int n = 0;
+    for (int i = 0; i < (int)corridor_.size(); i++) {
+        float f = (corridor_soa_.x[i] - in.plane_x) * sin_h - (corridor_soa_.z[i] - in.plane_z) * cos_h;
+        if (f >= -back)
+            corridor_[n++] = corridor_[i];
+    }
+
+    if (n < (int)corridor_.size()) {
+        corridor_.resize(n);
+        corridor_soa_.Gather(soa_, corridor_);
+    }
+}
+
+void Airport::FindNearestStand(const Snapshot& snap) {
+    // Check if the currently active stand is also the selected stand
+    if (active_stand_ >= 0 && active_stand_ == selected_stand_)
+        return;
+
+    float dist = stand_capture::kReject;
+    int min_stand = -1;
+
+    if (selected_stand_ >= 0) {
+        dist = 0.0;
+        min_stand = selected_stand_;
+    } else {
+        const stand_capture::Input in{snap.plane_x, snap.plane_z, snap.plane_hdgt, plane.nw_z, kCapZ + 50};
+
+        // Reseed the shortlist on a sharp turn, when the plane has left the corridor or
+        // the list ran empty. Otherwise just drop what is behind.
+        float moved = sqrtf(SQR(in.plane_x - corridor_x_) + SQR(in.plane_z - corridor_z_));
+        if (!corridor_valid_ || fabsf(fem::RA(in.plane_hdgt - corridor_hdgt_)) > kCorridorTurn ||
+            moved > corridor_len_ || (corridor_.empty() && now > corridor_ts_ + kNearestStandPeriod))
+            SeedCorridor(in, snap.ground_speed);
+        else
+            PruneCorridor(in);
+
+        int min_i = -1;
+        stand_capture::FindMin(corridor_soa_, 0, corridor_.size(), in, dist, min_i);
+        if (min_i >= 0)
+            min_stand = grid_stands_[corridor_[min_i]];
     }
 
     if (min_stand >= 0 && min_stand != active_stand_) {
@@ -725,39 +1302,288 @@ void Airport::FindNearestStand() {
         if (active_stand_ >= 0)
             stands_[active_stand_].SetIdle();
 
+        ms.Stream(true);
         ms.SetDgsDist();
+        predictor_.Reset();
         active_stand_ = min_stand;
         state_ = ENGAGED;
+        scheduler.Schedule(dgs_log_job_, 0.0f);
     }
 }
 
+void Airport::SetDepartureStand(int dsi) {
+    if (departure_stand_ >= 0)
+        stands_[departure_stand_].SetIdle();
+    LogMsg("Departure stand now '%s'", dsi >= 0 ? stands_[dsi].cname() : "*none*");
+    if (dsi >= 0) {
+        Stand& ds = stands_[dsi];
+        ds.Stream(true);
+        if (ds.r_.display_name.empty())
+            departure_txt_.Set("%s   ", name().c_str());
+        else
+            departure_txt_.Set("%s STAND %s   ", name().c_str(), ds.r_.display_name.c_str());
+    } else
+        departure_txt_.Clear();
+    departure_stand_ = dsi;
+}
+
+// transition within INACTIVE ... BOARDING, wakes up the jobs that serve the new state
+void Airport::SetState(state_t new_state) {
+    if (new_state == state_)
+        return;
+
+    state_ = new_state;
+    LogMsg("New state %s", state_str[state_]);
+    if (state_ == DEPARTURE)
+        scheduler.Schedule(ofp_job_, 0.0f);
+    scheduler.Schedule(state_machine_job_, 0.0f);
+}
+
+// runs every frame while the predictor is valid
+float Airport::UpdateDisplay() {
+    if (state_ != TRACK || track_ != 3 || active_stand_ < 0 || !predictor_.valid())
+        return 0.0f;  // stop until the state machine schedules us again
+
+    // same time base as the samples of the state machine
+    auto [nw_z, ref_x] = predictor_.Predict(now);
+    float distance = std::clamp(nw_z, kGoodZ_m, kCrZ);
+    float xtrack = std::roundf(std::clamp(ref_x, -4.0f, 4.0f) * 2.0f) / 2.0f;
+
+    // only push changes
+    int d = std::roundf(distance * 10.0f);
+    int x = std::roundf(xtrack * 2.0f);
+    if (d == display_d_ && x == display_x_)
+        return -1.0f;
+
+    display_d_ = d;
+    display_x_ = x;
+
+    Stand& as = stands_[active_stand_];
+    if (as.dgs_type_ == kMarshaller) {
+        if (marshaller.active())
+            marshaller.SetPos(&as.r_.drawinfo, status_, track_, lr_, distance);
+    } else
+        as.SetState(status_, track_, lr_, xtrack, distance, slow_);
+
+    return -1.0f;
+}
+
 // find the stand the plane is parked on
-int Airport::FindDepartureStand() {
-    float plane_x = XPLMGetDataf(plane_x_dr);
-    float plane_z = XPLMGetDataf(plane_z_dr);
-    float plane_hdgt = XPLMGetDataf(plane_true_psi_dr);
+int Airport::FindDepartureStand(const Snapshot& snap) {
+    const float plane_x = snap.plane_x;
+    const float plane_z = snap.plane_z;
+    const float plane_hdgt = snap.plane_hdgt;
 
     // nose wheel
     float nw_z = plane_z - plane.nw_z * cosf(kD2R * plane_hdgt);
     float nw_x = plane_x + plane.nw_z * sinf(kD2R * plane_hdgt);
 
-    for (int i = 0; i < (int)stands_.size(); i++) {
+    const auto it = departure_hash_.find(
+        DepartureHashKey((int)floorf(nw_x / kDepartureHashCell), (int)floorf(nw_z / kDepartureHashCell)));
+    if (it == departure_hash_.end())
+        return -1;
+
+    // the geometry comes from soa_, only a hit touches the Stand itself
+    int dsi = -1;
+    for (int j : it->second) {
+        if (fabsf(fem::RA(plane_hdgt - soa_.hdgt[j])) > 3.0f)
+            continue;
+
+        // Place() used the estimated elevation and an elevation error shifts x/z with the distance
+        // from the reference point. So the 1 m test needs a probed or cached elevation.
+        Stand& s = stands_[grid_stands_[j]];
+        if (!s.terrain_known_) {
+            s.UpdateXYZ();
+            soa_.x[j] = s.x_;
+            soa_.z[j] = s.z_;
+            soa_.valid[j] = !s.is_wet_;
+            if (s.is_wet_)
+                continue;
+        }
+
+        float dx = nw_x - soa_.x[j];
+        float dz = nw_z - soa_.z[j];
+        // LogMsg("stand: %s, z: %2.1f, x: %2.1f", stands_[grid_stands_[j]].cname(), dz, dx);
+        if (dx * dx + dz * dz >= kDepartureStandDist * kDepartureStandDist)
+            continue;
+
+        // the first matching stand as a scan of all stands would find it
+        int i = grid_stands_[j];
+        if (stands_[i].dgs_type_ == kVDGS && (dsi < 0 || i < dsi))
+            dsi = i;
+    }
+
+    return dsi;
+}
+
+float Airport::DepartureJob() {
+    if (state_ > BOARDING)
+        return 0.0f;    // ResetState() wakes us up
+
+    // While idle the state machine sleeps, so watch for a shift of the reference frame here.
+    // The stands are still in the old frame, the state machine moves them and runs us again.
+    CheckRefFrameShift();
+    if (ref_gen_ != ref_gen) {
+        scheduler.Schedule(state_machine_job_, 0.0f);
+        return 0.0f;
+    }
+
+    const Snapshot snap = Snapshot::Take();
+    watch_pos_ = fem::LLPos(XPLMGetDataf(plane_lat_dr), XPLMGetDataf(plane_lon_dr));
+    watch_beacon_ = snap.beacon;
+
+    // on beacon or engine or teleportation -> INACTIVE
+    if (plane.BeaconOn(snap) || plane.EnginesOn()) {
+        if (departure_stand_ >= 0)
+            stands_[departure_stand_].SetIdle();
+        departure_stand_ = -1;
+        SetState(INACTIVE);
+    } else {
+        // check for stand (new or changed)
+        int dsi = FindDepartureStand(snap);
+        // LogMsg("departure stand: %s, dsi: %d", dsi >= 0 ? stands_[dsi].cname() : "*none*", dsi);
+        if (dsi != departure_stand_) {
+            SetDepartureStand(dsi);
+            scheduler.Schedule(state_machine_job_, 0.0f);
+        }
+    }
+
+    // while idle nothing changes before the plane moves, Watch() wakes us up
+    return idle() ? 0.0f : kDepartureStandPeriod;
+}
+
+// While the airport is idle all its jobs sleep and the plane job is the only one that polls.
+// The departure job is woken up when the plane has moved, the beacon switch changed or
+// the reference frame shifted.
+void Airport::Watch(const fem::LLPos& pos) {
+    CheckRefFrameShift();
+    if (ref_gen_ != ref_gen || XPLMGetDatai(beacon_dr) != watch_beacon_ || fem::len(pos - watch_pos_) > kWatchMoveDist)
+        scheduler.Schedule(departure_job_, 0.0f);
+}
+
+void Airport::ScheduleStream() {
+    stream_due_ = true;
+    scheduler.Schedule(stream_job_, 0.0f);
+}
+
+// Keep VDGS instances only for the stands around the camera, nearest first and at most
+// kStreamBudget stands per frame. The active, selected and departure stands are always kept.
+// Stands whose terrain is not known yet are queued for the probe job first.
+// The stands are only walked again when the camera has moved by kStreamHysteresis or
+// something changed, see ScheduleStream().
+float Airport::StreamJob() {
+    const float view_x = XPLMGetDataf(view_x_dr);
+    const float view_z = XPLMGetDataf(view_z_dr);
+    if (!stream_due_ && stream_radius_ == stream_radius &&
+        SQR(view_x - stream_view_x_) + SQR(view_z - stream_view_z_) < SQR(kStreamHysteresis))
+        return kStreamIdlePeriod;
+
+    stream_view_x_ = view_x;
+    stream_view_z_ = view_z;
+    stream_radius_ = stream_radius;
+    const float r_in = stream_radius;
+    const float r_out = r_in + kStreamHysteresis;
+
+    int n_destroyed = 0, n_live = 0;
+    stream_candidates_.clear();
+    for (int j = 0; j < (int)grid_stands_.size(); j++) {
+        int i = grid_stands_[j];
         Stand& s = stands_[i];
         if (s.dgs_type_ != kVDGS)
             continue;
 
-        if (fabsf(fem::RA(plane_hdgt - s.hdgt())) > 3.0f)
-            continue;
+        float d2 = SQR(soa_.x[j] - view_x) + SQR(soa_.z[j] - view_z);
+        bool keep = (i == active_stand_ || i == selected_stand_ || i == departure_stand_);
+        if (s.in_range_) {     // a VDGS in range has its instances
+            if (!keep && d2 > r_out * r_out) {
+                s.Stream(false);
+                n_destroyed++;
+            } else
+                n_live++;
+        } else if (keep || (d2 <= r_in * r_in && s.terrain_known_))
+            stream_candidates_.emplace_back(d2, i);
+        else if (d2 <= r_in * r_in)
+            RequestProbe(i);    // the probe job wakes us up
+    }
+
+    const int n_create = std::min((int)stream_candidates_.size(), kStreamBudget);
+    std::partial_sort(stream_candidates_.begin(), stream_candidates_.begin() + n_create, stream_candidates_.end());
+    for (int k = 0; k < n_create; k++)
+        stands_[std::get<1>(stream_candidates_[k])].Stream(true);
+
+    if (n_create > 0 || n_destroyed > 0)
+        LogMsg("stream: created: %d, destroyed: %d, pending: %d, live: %d", n_create, n_destroyed,
+               (int)stream_candidates_.size() - n_create, n_live + n_create);
 
-        float dx = nw_x - s.x_;
-        float dz = nw_z - s.z_;
-        // LogMsg("stand: %s, z: %2.1f, x: %2.1f", s.cname(), dz, dx);
-        if (dx * dx + dz * dz < 1.0f)
-            // Return the first matching stand found
-            return i;
+    // the remaining candidates follow on the next frame
+    stream_due_ = (int)stream_candidates_.size() > n_create;
+    return stream_due_ ? -1.0f : kStreamPeriod;
+}
+
+void Airport::RequestProbe(int i) {
+    Stand& s = stands_[i];
+    if (s.terrain_known_ || s.probe_queued_)
+        return;
+
+    if (probe_queue_.empty())
+        scheduler.Schedule(probe_job_, 0.0f);
+    probe_queue_.push_back(i);
+    s.probe_queued_ = true;
+}
+
+// probe the queued stands, at most kProbeBudget per frame
+float Airport::ProbeJob() {
+    const int n = std::min((int)probe_queue_.size(), kProbeBudget);
+    bool wet = false;
+    for (int k = 0; k < n; k++) {
+        Stand& s = stands_[probe_queue_[k]];
+        s.UpdateXYZ();      // nothing to do if it was used in the meantime
+        s.probe_queued_ = false;
+        wet |= s.is_wet_;
     }
+    probe_queue_.erase(probe_queue_.begin(), probe_queue_.begin() + n);
+
+    if (wet)
+        BuildGrid();        // rare, the capture test must skip it
+    if (n > 0)
+        ScheduleStream();
 
-    return -1;
+    return probe_queue_.empty() ? 0.0f : -1.0f;
+}
+
+// cdm data may come in late during boarding
+void Airport::OfpJob() {
+    if ((state_ != DEPARTURE && state_ != BOARDING) || departure_stand_ < 0)
+        return;
+
+    Stand& ds = stands_[departure_stand_];
+    ofp = Ofp::LoadIfNewer(ofp_seqno);  // fetch ofp
+    if (ofp == nullptr)
+        return;
+
+    ofp_seqno = ofp->seqno;
+    std::string ofp_str = ofp->GenDepartureStr();
+    if (ds.r_.display_name.empty())
+        departure_txt_.Set("%s   %s   ", name().c_str(), ofp_str.c_str());
+    else
+        departure_txt_.Set("%s STAND %s   %s   ", name().c_str(), ds.r_.display_name.c_str(), ofp_str.c_str());
+
+    // extract arrival stand from ofp remarks if any
+    if (!ofp->dx_rmk.empty()) {
+        LogMsg("OFP Departure Remarks: '%s'", ofp->dx_rmk.c_str());
+        auto pos = ofp->dx_rmk.find("ARRIVAL_STAND=");
+        if (pos != std::string::npos) {
+            ofp_arrival_stand = ofp->dx_rmk.substr(pos + 14);
+            auto endpos = ofp_arrival_stand.find_first_of(";,\n\r");
+            if (endpos != std::string::npos)
+                ofp_arrival_stand = ofp_arrival_stand.substr(0, endpos);
+            ofp_destination = ofp->destination;
+            LogMsg("OFP Arrival Stand set to '%s@%s'", ofp_arrival_stand.c_str(), ofp_destination.c_str());
+        }
+    } else {
+        ofp_arrival_stand.clear();
+        ofp_destination.clear();
+    }
 }
 
 float Airport::StateMachine() {
@@ -767,141 +1593,96 @@ float Airport::StateMachine() {
     CheckRefFrameShift();   // ensure ref_gen is up to date
     if (ref_gen_ != ref_gen) {
         ref_gen_ = ref_gen;
-        LogMsg("reference frame changed, moving all instances");
-        for (auto& s : stands_) {
-            s.UpdateXYZ();
+        bool reorigined = ReOrigin();
+
+        // the stands that can matter soon are probed again, the others are when they are used
+        const float plane_x = XPLMGetDataf(plane_x_dr);
+        const float plane_z = XPLMGetDataf(plane_z_dr);
+        int n_probed = 0;
+        for (int i = 0; i < (int)stands_.size(); i++) {
+            Stand& s = stands_[i];
+            if (!s.placed())    // BuildStands() does that in the new frame
+                continue;
+
+            if (!reorigined || i == active_stand_ || i == departure_stand_ ||
+                SQR(s.x_ - plane_x) + SQR(s.z_ - plane_z) < SQR(kReprobeRadius)) {
+                s.UpdateXYZ();
+                n_probed++;
+            }
+
             if (s.dgs_type_ == kVDGS) {
-                assert(s.pole_base_inst_ref_);
-                XPLMInstanceSetPosition(s.pole_base_inst_ref_, &s.drawinfo_, nullptr);
-                float y_0 = s.drawinfo_.y;
-                s.drawinfo_.y += kVdgsDefaultHeight;
-                XPLMInstanceSetPosition(s.vdgs_inst_ref_, &s.drawinfo_, s.drefs_);
-                s.drawinfo_.y = y_0;
+                if (!s.in_range_)    // not streamed in
+                    continue;
+                s.r_.pole_base_pushed.SetPosition(s.r_.pole_base_inst_ref, &s.r_.drawinfo, nullptr);
+                float y_0 = s.r_.drawinfo.y;
+                s.r_.drawinfo.y += kVdgsDefaultHeight;
+                s.r_.vdgs_pushed.SetPosition(s.r_.vdgs_inst_ref, &s.r_.drawinfo, s.r_.drefs);
+                s.r_.drawinfo.y = y_0;
             } else {
                 // marshaller
-                if (marshaller)
-                    marshaller->SetPos(&s.drawinfo_);
+                marshaller.SetPos(&s.r_.drawinfo);
             }
         }
-    }
 
-    state_t state_prev = state_;
+        LogMsg("reference frame changed, stands transformed: %s, probed again: %d", reorigined ? "yes" : "no",
+               n_probed);
+        BuildGrid();
+        ScheduleStream();
+        scheduler.Schedule(departure_job_, 0.0f);   // it skipped the lookup during the shift
+    }
 
     // DEPARTURE and friends ...
     // that's all low freq stuff
     if (INACTIVE <= state_ && state_ <= BOARDING) {
-        if (now > departure_stand_ts_ + 2.0f) {
-            departure_stand_ts_ = now;
-            // on beacon or engine or teleportation -> INACTIVE
-            if (plane.BeaconOn() || plane.EnginesOn()) {
-                if (departure_stand_ >= 0)
-                    stands_[departure_stand_].SetIdle();
-                departure_stand_ = -1;
-                state_ = INACTIVE;
-                return 2.0f;
-            }
-
-            // check for stand (new or changed)
-            int dsi = FindDepartureStand();
-            // LogMsg("departure stand: %s, dsi: %d", dsi >= 0 ? stands_[dsi].cname() : "*none*", dsi);
-            if (dsi != departure_stand_) {
-                if (departure_stand_ >= 0)
-                    stands_[departure_stand_].SetIdle();
-                LogMsg("Departure stand now '%s'", dsi >= 0 ? stands_[dsi].cname() : "*none*");
-                if (dsi >= 0) {
-                    Stand& ds = stands_[dsi];
-                    if (ds.display_name_.empty())
-                        ds.scroll_txt_ = std::make_unique<ScrollTxt>(name() + "   ");
-                    else
-                        ds.scroll_txt_ = std::make_unique<ScrollTxt>(name() + " STAND " + ds.display_name_ + "   ");
-                }
-                departure_stand_ = dsi;
-            }
-        }
-
         if (departure_stand_ < 0) {
-            state_ = INACTIVE;
-            return 4.0f;
+            SetState(INACTIVE);
+            return 0.0f;  // idle, sleep until DepartureJob() finds a stand
         }
 
         Stand& ds = stands_[departure_stand_];
 
-        if (plane.PaxNo() <= 0) {
-            state_ = DEPARTURE;
-            if (state_ != state_prev)
-                LogMsg("New state %s", state_str[state_]);
+        // a plugin's dataref, read once
+        const int pax_no = plane.PaxNo();
+        if (pax_no <= 0) {
+            SetState(DEPARTURE);
             // FALLTHROUGH
         }
 
         if (state_ == INACTIVE) {
-            return std::min(4.0f, ds.SetState(0));
-        }
-
-        // cdm data may come in late during boarding
-        if (state_ == DEPARTURE || state_ == BOARDING) {
-            // although LoadIfNewer is cheap throttling it is even cheaper
-            if (now > ofp_ts + 5.0f) {
-                ofp_ts = now;
-                ofp = Ofp::LoadIfNewer(ofp_seqno);  // fetch ofp
-                if (ofp) {
-                    ofp_seqno = ofp->seqno;
-                    std::string ofp_str = ofp->GenDepartureStr();
-                    if (ds.display_name_.empty())
-                        ds.scroll_txt_ = std::make_unique<ScrollTxt>(name() + "   " + ofp_str + "   ");
-                    else
-                        ds.scroll_txt_ = std::make_unique<ScrollTxt>(name() + " STAND " + ds.display_name_ + "   " +
-                                                                     ofp_str + "   ");
-
-                    // extract arrival stand from ofp remarks if any
-                    if (!ofp->dx_rmk.empty()) {
-                        LogMsg("OFP Departure Remarks: '%s'", ofp->dx_rmk.c_str());
-                        auto pos = ofp->dx_rmk.find("ARRIVAL_STAND=");
-                        if (pos != std::string::npos) {
-                            ofp_arrival_stand = ofp->dx_rmk.substr(pos + 14);
-                            auto endpos = ofp_arrival_stand.find_first_of(";,\n\r");
-                            if (endpos != std::string::npos)
-                                ofp_arrival_stand = ofp_arrival_stand.substr(0, endpos);
-                            ofp_destination = ofp->destination;
-                            LogMsg("OFP Arrival Stand set to '%s@%s'", ofp_arrival_stand.c_str(),
-                                   ofp_destination.c_str());
-                        }
-                    } else {
-                        ofp_arrival_stand.clear();
-                        ofp_destination.clear();
-                    }
-                }
-            }
+            return std::min(4.0f, ds.SetState(0, departure_txt_));
         }
 
         if (state_ == DEPARTURE) {
-            if (plane.PaxNo() > 0) {
-                state_ = BOARDING;
-                LogMsg("New state %s", state_str[state_]);
+            if (pax_no > 0) {
+                SetState(BOARDING);
                 // FALLTHROUGH
             } else
-                return ds.SetState(0);  // just scroll the text
+                return ds.SetState(0, departure_txt_);  // just scroll the text
         }
 
         if (state_ == BOARDING) {
-            int pax_no = plane.PaxNo();
             // LogMsg("boarding PaxNo: %d", pax_no);
-            return ds.SetState(pax_no);
+            return ds.SetState(pax_no, departure_txt_);
         }
     }
 
     // ARRIVAL and friends ...
     // this can be high freq stuff
+    const Snapshot snap = Snapshot::Take();
 
-    // throttle costly search...
-    // ... but if we have a new selected stand activate it immediately
-    if (now > nearest_stand_ts_ + 2.0 || (selected_stand_ >= 0 && selected_stand_ != active_stand_)) {
-        FindNearestStand();
-        nearest_stand_ts_ = now;
-    }
+    if (arrival_runs_ > 0)
+        arrival_fixed_runs_ += (now - arrival_ts_) / arrival_fixed_delay_;
+    arrival_runs_++;
+    arrival_ts_ = now;
+    arrival_fixed_delay_ = kTrackMaxDelay;
+
+    // with the corridor shortlist this is cheap enough for every tick
+    FindNearestStand(snap);
 
     if (active_stand_ < 0) {
         state_ = ARRIVAL;
-        return 2.0;
+        arrival_fixed_delay_ = kNearestStandPeriod;
+        return kNearestStandPeriod;
     }
 
     state_t new_state = state_;
@@ -910,18 +1691,18 @@ float Airport::StateMachine() {
     int track_prev = track_;
     float distance_prev = distance_;
 
-    float loop_delay = 0.2;
+    float loop_delay = kTrackMaxDelay;
 
     Stand& as = stands_[active_stand_];
 
     // xform plane pos into stand local coordinate system
-    float dx = XPLMGetDataf(plane_x_dr) - as.x_;
-    float dz = XPLMGetDataf(plane_z_dr) - as.z_;
+    float dx = snap.plane_x - as.x_;
+    float dz = snap.plane_z - as.z_;
     float local_x =  as.cos_hdgt_ * dx + as.sin_hdgt_ * dz;
     float local_z = -as.sin_hdgt_ * dx + as.cos_hdgt_ * dz;
 
     // relative heading in stand local system +/ 180°
-    float local_hdgt = fem::RA(XPLMGetDataf(plane_true_psi_dr) - as.hdgt());
+    float local_hdgt = fem::RA(snap.plane_hdgt - as.hdgt());
 
     // nose wheel
     float nw_z = local_z - plane.nw_z;
@@ -947,7 +1728,7 @@ float Airport::StateMachine() {
         azimuth_nw = 0.0;
 
     bool locgood = (fabsf(mw_x) <= kGoodX && kGoodZ_m <= nw_z && nw_z <= kGoodZ_p);
-    bool beacon_on = plane.BeaconOn();
+    bool beacon_on = plane.BeaconOn(snap);
 
     status_ = lr_ = track_ = 0;
     distance_ = nw_z;
@@ -1013,7 +1794,7 @@ float Airport::StateMachine() {
                 else if (d_hdgt > 1.5f)
                     lr_ = kTurnRight;
 
-                if (now > update_dgs_log_ts_ + 2.0)
+                if (dgs_log_due_)
                     LogMsg(
                         "req_hdgt: %0.1f, local_hdgt: %0.1f, d_hdgt: %0.1f, mw: (%0.1f, %0.1f), nw: (%0.1f, %0.1f), "
                         "ref: (%0.1f, %0.1f), "
@@ -1030,22 +1811,35 @@ float Airport::StateMachine() {
 
             // decide whether to show the SLOW indication
             // depends on distance and ground speed
-            float gs = XPLMGetDataf(ground_speed_dr);
+            const float gs = snap.ground_speed;
             slow = (distance_ > 20.0f && gs > 4.0f) || (10.0f < distance_ && distance_ <= 20.0f && gs > 3.0f) ||
                    (distance_ <= 10.0f && gs > 2.0f);
 
             if (distance_ <= kCrZ / 2) {
                 track_ = 3;
-                loop_delay = 0.03;
+                arrival_fixed_delay_ = 0.03f;
             } else  // azimuth only
                 track_ = 2;
 
+            // Wake up again when the plane has moved by one step of the display:
+            // 0.2 m below 3 m, 0.5 m for the closing rate bar and 1 m beyond.
+            // Close to the stop a step must stay within half the stop window so GOOD can't be skipped.
+            float step = (distance_ < 3.0f) ? 0.2f : (distance_ <= kCrZ ? 0.5f : 1.0f);
+            if (track_ == 3)
+                step = std::min(step, 0.5f * (kGoodZ_p - kGoodZ_m));
+            loop_delay = std::clamp(step / std::max(gs, 0.01f), kTrackMinDelay, kTrackMaxDelay);
+
+            // once the distance is shown the display loop extrapolates between our runs,
+            // the state evaluation keeps its own delay from above
+            predictor_.AddSample(now, nw_z, ref_x);
+            if (track_ == 3 && predictor_.valid())
+                scheduler.Schedule(display_job_, 0.0f);
+
             // For the Marshaller sync change of straight ahead / turn commands with arm position
             if (as.dgs_type_ == kMarshaller) {
                 // catch the phase ~180° point -> the Marshaller's arm is straight
-                float sin_wave = XPLMGetDataf(sin_wave_dr);
-                bool phase180 = (sin_wave_prev_ > 0.0) && (sin_wave <= 0.0);
-                sin_wave_prev_ = sin_wave;
+                bool phase180 = (sin_wave_prev_ > 0.0) && (snap.sin_wave <= 0.0);
+                sin_wave_prev_ = snap.sin_wave;
 
                 if (!phase180) {
                     lr_ = lr_prev;
@@ -1063,10 +1857,9 @@ float Airport::StateMachine() {
             status_ = 2;
             lr_ = 3;
 
-            int parkbrake_set = (XPLMGetDataf(parkbrake_dr) > 0.5);
             if (!locgood)
                 new_state = TRACK;
-            else if (parkbrake_set || !beacon_on)
+            else if (snap.parkbrake_set || !beacon_on)
                 new_state = PARKED;
         } break;
 
@@ -1123,15 +1916,15 @@ float Airport::StateMachine() {
 
     if (new_state != state_) {
         LogMsg("state transition %s -> %s, beacon: %d", state_str[state_], state_str[new_state], beacon_on);
+        predictor_.Reset();
         state_ = new_state;
         timestamp_ = now;
         return -1;  // see you on next frame
     }
 
     if (state_ > ARRIVAL) {
-        // don't flood the log
-        if (now > update_dgs_log_ts_ + 2.0) {
-            update_dgs_log_ts_ = now;
+        if (dgs_log_due_) {
+            dgs_log_due_ = false;
             LogMsg("stand: %s, state: %s, status: %d, track: %d, lr: %d, distance: %0.2f, xtrack: %0.1f m",
                    as.name().c_str(), state_str[state_], status_, track_, lr_, distance_, xtrack);
         }
@@ -1143,12 +1936,12 @@ float Airport::StateMachine() {
         }
 
         distance_ = std::clamp(distance_, kGoodZ_m, kCrZ);
+        slow_ = slow;
+        display_d_ = std::roundf(distance_ * 10.0f);
+        display_x_ = std::roundf(xtrack * 2.0f);
 
         if (as.dgs_type_ == kMarshaller) {
-            if (marshaller == nullptr)
-                marshaller = std::make_unique<Marshaller>();
-
-            marshaller->SetPos(&as.drawinfo_, status_, track_, lr_, distance_);
+            marshaller.SetPos(&as.r_.drawinfo, status_, track_, lr_, distance_);
         } else
             as.SetState(status_, track_, lr_, xtrack, distance_, slow);
     }
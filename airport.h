@@ -26,62 +26,109 @@
 #include <memory>
 #include <tuple>
 
+#include "XPLMProcessing.h"
+
+#include "stand_capture.h"
+#include "instance_pool.h"
+
+// a fixed buffer so a change of the text does not allocate
 class ScrollTxt {
-    std::string txt_;           // text to scroll
+    static constexpr int kMaxLen = 256;
+    char txt_[kMaxLen];         // text to scroll
+    int len_;                   // 0: no text
     int char_pos_;              // next char to enter on the right
     int dr_scroll_;             // dref value for scroll ctrl
-    char chars_[kR1Nchar]{};    // chars currently visible
+    char chars_[kR1Nchar];      // chars currently visible
 
   public:
-    ScrollTxt(const std::string& txt);
+    ScrollTxt() : len_(0) {}
+    void Set(const char *fmt, ...) __attribute__((format(printf, 2, 3)));  // truncated to kMaxLen - 1
+    void Clear() { len_ = 0; }
+    bool active() const { return len_ > 0; }
     void Tick(float *drefs);
 };
 
+// least squares fit of a linear motion to recent samples of a position z, x
+// to extrapolate the position between runs of the state machine
+class MotionPredictor {
+    static constexpr int kN = 8;  // max # of samples
+    float t_[kN], z_[kN], x_[kN];
+    int n_, head_;                // # of samples, next slot
+    bool valid_;
+    float t0_, z0_, x0_, vz_, vx_;  // the fit, z(t) = z0_ + vz_ * (t - t0_)
+
+  public:
+    MotionPredictor() { Reset(); }
+    void Reset() { n_ = head_ = 0; valid_ = false; }
+    void AddSample(float t, float z, float x);
+
+    bool valid() const { return valid_; }
+    std::tuple<float, float> Predict(float t) const;  // z, x
+};
+
+// The display and rendering state of a stand, only touched when the stand is displayed, probed or saved.
+// It lives in Airport::render_ indexed like Airport::stands_, so the scans over the stands stay on small objects.
+struct StandRender {
+    std::string display_name;   // for use in the VDGS
+
+    float drawinfo_dgs_dist;    // last dgs_dist_ used in drawinfo
+    XPLMDrawInfo_t drawinfo;
+    float drefs[DGS_DR_NUM];
+    XPLMInstanceRef vdgs_inst_ref, pole_base_inst_ref;  // only while in range, see Stand::Stream()
+    PushCache vdgs_pushed, pole_base_pushed;
+
+    // persistent across sessions, see Airport::LoadGeoCache()
+    bool from_cache;            // elevation_, is_wet_ are from the cache and not verified yet
+    bool geo_dirty;             // probed values that are not in the cache
+    float geo_dgs_dist, geo_dgs_dy;     // dgs_dist_ of the last draw position and its height above the stand
+};
+
 // AptStand augmented
 class Stand {
 	const AptStand& as_;
-    std::string display_name_;  // for use in the VDGS
+    StandRender& r_;
 
   protected:
     friend class Airport;
 
     double elevation_;     // ground elevation of stand [m] (starts as an estimate from plane at touchdown)
     int ref_gen_;          // reference frame generation number
+    bool probed_;          // x_, y_, z_, r_.drawinfo are from terrain probes, not transformed by Airport::ReOrigin()
+    bool terrain_known_;   // elevation_, is_wet_ are from terrain probes or the geo cache, not the estimate of Place()
+    bool probe_queued_;    // in Airport::probe_queue_
     float x_, y_, z_;
 
     float sin_hdgt_, cos_hdgt_;
     int dgs_type_;
     bool is_wet_;
-
-    float drawinfo_dgs_dist_;  // last dgs_dist_ used in drawinfo_
-    XPLMDrawInfo_t drawinfo_;
-    float drefs_[DGS_DR_NUM];
-    XPLMInstanceRef vdgs_inst_ref_, pole_base_inst_ref_;
+    bool in_range_;             // instances wanted, see Airport::StreamJob(), a VDGS then has them
 
     float dgs_dist_;            // distance to dgs
     float marshaller_max_dist_; // max distance, actual can be lower according to PE
-    std::unique_ptr<ScrollTxt> scroll_txt_;
 
-    void UpdateXYZ();      // x_, y_, z_, drawinfo_ from as_.lon, as_.lat, reference frame
+    void Place();          // x_, y_, z_, r_.drawinfo without terrain probes
+    void UpdateXYZ();      // x_, y_, z_, r_.drawinfo from as_.lon, as_.lat, reference frame
     void SetDgsDist();
+    void Stream(bool in_range); // create or destroy the instances
 
   public:
     Stand(Stand&&) = default;
     Stand& operator=(Stand&&) = delete;
 
-    Stand(const AptStand& as, float elevation, int dgs_type, float dist_adjust);
+    Stand(const AptStand& as, StandRender& r, float elevation, int dgs_type, float dist_adjust);
     ~Stand();
 
     void SetDgsType(int dgs_type);
     void CycleDgsType();
     void DgsMoveCloser();           // with wrap around
     void SetState(int status, int track, int lr, float azimuth, float distance, bool slow);
-    float SetState(int pax_no);     // -> delay
+    float SetState(int pax_no, ScrollTxt& scroll_txt);  // -> delay
     void SetIdle();
 
     // accessors
     const std::string& name() const { return as_.name; };
     const char *cname() const { return as_.name.c_str(); };
+    bool placed() const { return ref_gen_ >= 0; }  // x_, y_, z_ are valid
     bool has_jw() const { return as_.has_jw; }
     float hdgt() const { return as_.hdgt; }
     double lat() const { return as_.lat; }
@@ -106,23 +153,97 @@ class Airport {
     std::string name_;
     state_t state_;
 
+    std::vector<StandRender> render_;   // indexed like stands_, declared first so it outlives them
     std::vector<Stand> stands_;
+
+    // uniform grid over the stands in the local x/z frame
+    // the stands of cell c are grid_stands_[grid_start_[c]] ... grid_stands_[grid_start_[c + 1] - 1]
+    float grid_x0_, grid_z0_;       // lower left corner
+    int grid_nx_, grid_nz_;         // # of cells in x, z
+    // stands placed after the last BuildGrid() follow as an unsorted tail from grid_start_.back() on
+    std::vector<int> grid_start_;   // grid_nx_ * grid_nz_ + 1 entries
+    std::vector<int> grid_stands_;  // indices into stands_ sorted by cell
+    stand_capture::StandSoA soa_;   // capture test data in the order of grid_stands_
+
+    // quantized local x/z -> indices into soa_ of the stands whose departure capture disc overlaps the cell
+    std::unordered_map<uint64_t, std::vector<int>> departure_hash_;
+
+    // shortlist of candidates for FindNearestStand in the plane's forward corridor
+    std::vector<int> corridor_;             // indices into soa_
+    stand_capture::StandSoA corridor_soa_;  // soa_ gathered for corridor_
+    bool corridor_valid_;
+    float corridor_x_, corridor_z_, corridor_hdgt_, corridor_len_;  // at time of seeding
+    float corridor_back_;       // rear bound of the seed, also used by PruneCorridor()
+    float corridor_ts_;
+
     int active_stand_;      // -1 or index into stands_
     int selected_stand_;
     int departure_stand_;
-    float departure_stand_ts_;
+    ScrollTxt departure_txt_;   // only the departure stand scrolls a text
 
     bool user_cfg_changed_;
 
     // values that must survive a single run of the state_machine
     int status_, track_, lr_;
     float timestamp_, distance_, sin_wave_prev_;
-    float nearest_stand_ts_, update_dgs_log_ts_;
-
-    void FindNearestStand();
-    int FindDepartureStand();   // index in to stands_
+    bool dgs_log_due_;      // don't flood the log
+
+    // per frame update of the displayed distance and xtrack between runs of the state machine
+    MotionPredictor predictor_;     // nw_z, ref_x in the frame of the active stand
+    bool slow_;
+    int display_d_, display_x_;     // last displayed values, quantized
+
+    // statistics of the flight loop scheduling during an arrival
+    int arrival_runs_;              // runs of the state machine
+    float arrival_fixed_runs_;      // estimate for the former fixed delays
+    float arrival_fixed_delay_, arrival_ts_;
+
+    // stands are placed in the local frame over several frames, the grid only contains placed stands
+    std::vector<int> build_order_;  // indices into stands_, nearest to the plane first
+    int build_next_;                // next in build_order_
+    bool BuildStands();     // place the next stands within kBuildBudget, -> true when all are placed
+
+    // terrain probing of stands is deferred until they are candidates for something
+    std::vector<int> probe_queue_;  // indices into stands_
+    void RequestProbe(int i);
+    float ProbeJob();       // -> delay
+
+    bool ReOrigin();        // move the placed stands into a new reference frame without probes
+
+    void BuildGrid();       // (re)build grid, soa_, departure_hash_ from the placed stands in the current reference frame
+    void AddToGrid(int i);  // append a just placed stand to the tail of the grid
+    void AddToDepartureHash(int j);     // j = index into soa_
+    void SeedCorridor(const stand_capture::Input& in, float ground_speed);
+    void PruneCorridor(const stand_capture::Input& in);
+    void FindNearestStand(const Snapshot& snap);
+    int FindDepartureStand(const Snapshot& snap);   // index in to stands_
+    void SetDepartureStand(int dsi);
+    void SetState(state_t new_state);   // for the departure states, see ResetState() otherwise
     void FlushUserCfg();
 
+    // per airport cache of the probed terrain data in user_cfg_dir, valid for the scenery it was made with
+    uint64_t geo_fingerprint_;  // of the apt.dat data of stands_
+    bool geo_cache_pending_;    // read by the file_writer thread, picked up by BuildStands()
+    bool LoadGeoCache();        // -> false while the read is pending
+    void SaveGeoCache();
+
+    // instance streaming
+    std::vector<std::tuple<float, int>> stream_candidates_;  // squared distance, index into stands_
+    float stream_view_x_, stream_view_z_;   // camera position and stream_radius of the last full pass of StreamJob()
+    int stream_radius_;
+    bool stream_due_;       // a full pass is needed regardless of the camera position
+    void ScheduleStream();  // run a full pass of StreamJob() on the next frame
+
+    // scheduler jobs
+    int state_machine_job_, departure_job_, ofp_job_, dgs_log_job_, display_job_, stream_job_, build_job_,
+        probe_job_;
+    fem::LLPos watch_pos_;      // plane position and beacon switch as of the last DepartureJob(), see Watch()
+    int watch_beacon_;
+    float DepartureJob();       // -> delay
+    void OfpJob();
+    float StreamJob();          // -> delay
+    float UpdateDisplay();      // -> delay
+
   public:
     static std::unique_ptr<Airport> LoadAirport(const std::string& icao);
     // Load airport from position
@@ -133,7 +254,7 @@ class Airport {
     ~Airport();
 
     int nstands() const { return stands_.size(); }
-    std::tuple<int, const std::string> GetStand(int idx) const;  // dgs_type, name
+    std::tuple<int, const std::string&> GetStand(int idx) const;  // dgs_type, name
 
     void ResetState(state_t new_state);
     void SetSelectedStand(int selected_stand);
@@ -145,10 +266,12 @@ class Airport {
     void CycleDgsType();
 
     float StateMachine();
+    void Watch(const fem::LLPos& pos);  // pos = plane position, see PlaneJob()
 
     // accessors
     const std::string& name() const { return name_; }
     state_t state() const { return state_; }
+    bool idle() const { return state_ == INACTIVE && departure_stand_ < 0; }  // nothing to display
     int selected_stand() const { return selected_stand_; }
 };
 
@@ -0,0 +1,70 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "alloc_count.h"
+
+// the file writer thread allocates as well
+static std::atomic<uint64_t> n_alloc;
+
+uint64_t AllocCount() {
+    return n_alloc;
+}
+
+void* operator new(size_t size) {
+    n_alloc++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// portable, the pointer returned by malloc is stored in front of the aligned block
+void* operator new(size_t size, std::align_val_t align) {
+    n_alloc++;
+    size_t a = static_cast<size_t>(align);
+    void* raw = std::malloc(size + a + sizeof(void*));
+    if (raw == nullptr)
+        throw std::bad_alloc();
+    uintptr_t p = ((uintptr_t)raw + sizeof(void*) + a - 1) & ~(uintptr_t)(a - 1);
+    ((void**)p)[-1] = raw;
+    return (void*)p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    if (p)
+        std::free(((void**)p)[-1]);
+}
+
+void operator delete(void* p, size_t, std::align_val_t align) noexcept {
+    operator delete(p, align);
+}
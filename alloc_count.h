@@ -0,0 +1,30 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#ifndef _ALLOC_COUNT_H_
+#define _ALLOC_COUNT_H_
+
+#include <cstdint>
+
+// Test builds with ALLOC_COUNT=1 replace the global operator new and delete
+// to assert that the steady state does not allocate, see Makefile.common.
+uint64_t AllocCount();      // # of heap allocations so far
+#endif
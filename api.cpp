@@ -20,11 +20,17 @@
 //    USA
 //
 
+#include <algorithm>
+
 #include "autodgs.h"
+#include "instance_pool.h"
 
 enum {
     API_OPERATION_MODE,
     API_ON_GROUND,
+    API_STREAM_RADIUS,
+    API_PUSHES,
+    API_PUSHES_SKIPPED,
 };
 
 // API accessor routines
@@ -36,6 +42,12 @@ api_getint(XPLMDataRef ref)
             return operation_mode;
         case API_ON_GROUND:
             return on_ground;
+        case API_STREAM_RADIUS:
+            return stream_radius;
+        case API_PUSHES:
+            return n_push;
+        case API_PUSHES_SKIPPED:
+            return n_push_skipped;
     }
 
     return 0;
@@ -45,8 +57,7 @@ static void
 api_setint(XPLMDataRef ref, int val)
 {
     switch ((long long)ref) {
-        case API_OPERATION_MODE:
-            ; // required by some gcc versions
+        case API_OPERATION_MODE: {
             opmode_t mode = (opmode_t)val;
             if (mode != MODE_AUTO && mode != MODE_MANUAL) {
                 LogMsg("API: trying to set invalid operation_mode %d, ignored", val);
@@ -59,6 +70,16 @@ api_setint(XPLMDataRef ref, int val)
             LogMsg("API: operation_mode set to %s", opmode_str[mode]);
             operation_mode = mode;
             break;
+        }
+
+        case API_STREAM_RADIUS:
+            val = std::max(val, kStreamRadiusMin);
+            if (val == stream_radius)   // see above
+                return;
+
+            stream_radius = val;
+            LogMsg("API: stream_radius set to %d", stream_radius);
+            break;
     }
 }
 
@@ -74,4 +95,17 @@ create_api_drefs()
     XPLMRegisterDataAccessor("AutoDGS/on_ground", xplmType_Int, 0, api_getint, NULL, NULL,
                              NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
                              (void *)API_ON_GROUND, NULL);
+
+    XPLMRegisterDataAccessor("AutoDGS/stream_radius", xplmType_Int, 1, api_getint, api_setint, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                             (void *)API_STREAM_RADIUS, (void *)API_STREAM_RADIUS);
+
+    // statistics of XPLMInstanceSetPosition calls
+    XPLMRegisterDataAccessor("AutoDGS/stats/instance_pushes", xplmType_Int, 0, api_getint, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                             (void *)API_PUSHES, NULL);
+
+    XPLMRegisterDataAccessor("AutoDGS/stats/instance_pushes_skipped", xplmType_Int, 0, api_getint, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                             (void *)API_PUSHES_SKIPPED, NULL);
 }
@@ -41,7 +41,6 @@ struct Jetway {
 	fem::LLPos pos;
 	float hdgt;
 	float length;
-    fem::LLPos cabin;    // = pos + length * dir(hdgt)
 };
 
 std::unordered_map<std::string, AptAirport*> apt_airports;
@@ -99,6 +98,14 @@ static bool operator<(const AptStand& a, const AptStand& b) {
     return a.name < b.name;
 }
 
+std::pair<int, int> AptAirport::FindStands(std::string_view name) const {
+    auto first = std::lower_bound(stands_.begin(), stands_.end(), name,
+                                  [](const AptStand& s, std::string_view n) { return s.name < n; });
+    auto last = std::upper_bound(first, stands_.end(), name,
+                                 [](std::string_view n, const AptStand& s) { return n < s.name; });
+    return {first - stands_.begin(), last - stands_.begin()};
+}
+
 void AptAirport::dump() const {
     LogMsg("Dump of airport: %s", icao_.c_str());
 
@@ -117,33 +124,60 @@ void AptAirport::dump() const {
     }
 }
 
-void AptAirport::ComputeBBox() {
-    static constexpr double kDlat = 150.0 / fem::kLat2m;  // 150 m grace distance
+// attach the local frame at the center of the stands and
+// compute local coordinates of stands and runways
+void AptAirport::SetupFrame() {
+    // average relative to the first stand to be safe at the date line
+    const fem::LLPos s0{stands_[0].lat, stands_[0].lon};
+    double sum_lat = 0.0, sum_dlon = 0.0;
+    for (const auto& s : stands_) {
+        sum_lat += s.lat;
+        sum_dlon += fem::RA(s.lon - s0.lon);
+    }
 
-    bbox_max_ = {-1000.0, -1000.0};
-    bbox_min_ = {+1000.0, +1000.0};
+    const double n = stands_.size();
+    frame_ = fem::LocalFrame({sum_lat / n, fem::RA(s0.lon + sum_dlon / n)});
 
-    for (const auto& s : stands_) {
-        const double dlon = kDlat * cosf(s.lat * kD2R);
-        bbox_min_.lon = std::min(bbox_min_.lon, fem::RA(s.lon - dlon));
-        bbox_max_.lon = std::max(bbox_max_.lon, fem::RA(s.lon + dlon));
-        bbox_min_.lat = std::min(bbox_min_.lat, s.lat - kDlat);
-        bbox_max_.lat = std::max(bbox_max_.lat, s.lat + kDlat);
+    for (auto& s : stands_)
+        s.pos = frame_.ToLocal({s.lat, s.lon});
+
+    for (auto& r : rwys_) {
+        r.p1 = frame_.ToLocal(r.end1);
+        r.p2 = frame_.ToLocal(r.end2);
+        r.cl = r.p2 - r.p1;  // center line vector
+        r.len = fem::len(r.cl);
+        if (r.len < 1.0f)
+            LogMsg("Runway '%s' too short: %0.1f", r.name.c_str(), r.len);
+        else
+            r.cl = (1.0f / r.len) * r.cl;  // normalize
     }
 
+    std::erase_if(rwys_, [](const AptRunway& r) { return r.len < 1.0f; });
+}
+
+void AptAirport::ComputeBBox() {
+    static constexpr float kGrace = 150.0f;  // m
+
+    fem::Vec2f min{+1.0E7f, +1.0E7f}, max{-1.0E7f, -1.0E7f};
+
+    auto extend = [&](const fem::Vec2f& p) {
+        min.x = std::min(min.x, p.x);
+        min.y = std::min(min.y, p.y);
+        max.x = std::max(max.x, p.x);
+        max.y = std::max(max.y, p.y);
+    };
+
+    for (const auto& s : stands_)
+        extend(s.pos);
+
     for (const auto& r : rwys_) {
-        const double dlon = kDlat * cosf(r.end1.lat * kD2R);
-        bbox_min_.lon = std::min(bbox_min_.lon, fem::RA(r.end1.lon - dlon));
-        bbox_max_.lon = std::max(bbox_max_.lon, fem::RA(r.end1.lon + dlon));
-        bbox_min_.lat = std::min(bbox_min_.lat, r.end1.lat - kDlat);
-        bbox_max_.lat = std::max(bbox_max_.lat, r.end1.lat + kDlat);
-
-        bbox_min_.lon = std::min(bbox_min_.lon, fem::RA(r.end2.lon - dlon));
-        bbox_max_.lon = std::max(bbox_max_.lon, fem::RA(r.end2.lon + dlon));
-        bbox_min_.lat = std::min(bbox_min_.lat, r.end2.lat - kDlat);
-        bbox_max_.lat = std::max(bbox_max_.lat, r.end2.lat + kDlat);
+        extend(r.p1);
+        extend(r.p2);
     }
 
+    bbox_min_ = frame_.ToLLPos({min.x - kGrace, min.y - kGrace});
+    bbox_max_ = frame_.ToLLPos({max.x + kGrace, max.y + kGrace});
+
     // LogMsg("BBox for airport %s: min: %0.8f,%0.8f, max: %0.8f,%0.8f",
     //        icao_.c_str(), bbox_min_.lat, bbox_min_.lon, bbox_max_.lat, bbox_max_.lon);
 }
@@ -171,16 +205,28 @@ static bool ParseAptDat(const std::string& fn, bool ignore) {
 
         // LogMsg("Save ---> '%s', %d, %d", arpt->icao_.c_str(), arpt->has_twr_, (int)arpt->stands_.size());
         if (arpt->has_twr_ && arpt->stands_.size() > 0) {
+            arpt->SetupFrame();
+
+            // cabin = pos + length * dir(hdgt)
+            std::vector<fem::Vec2f> cabins;
+            cabins.reserve(jetways.size());
+            for (auto const& jw : jetways) {
+                fem::Vec2f dir{cosf((90.0f - jw.hdgt) * kD2R), sinf((90.0f - jw.hdgt) * kD2R)};
+                cabins.push_back(arpt->frame_.ToLocal(jw.pos) + jw.length * dir);
+            }
+
             for (auto& s : arpt->stands_)
-                for (auto& jw : jetways)
-                    if (fem::len(jw.cabin - fem::LLPos{s.lon, s.lat}) < kJw2Stand) {
+                for (auto const& c : cabins) {
+                    const fem::Vec2f d = c - s.pos;
+                    if (d * d < kJw2Stand * kJw2Stand) {
                         s.has_jw = true;
                         break;
                     }
+                }
 
             n_stands += arpt->stands_.size();
             arpt->stands_.shrink_to_fit();
-            std::sort(arpt->stands_.begin(), arpt->stands_.end());
+            std::stable_sort(arpt->stands_.begin(), arpt->stands_.end());
             apt_airports[arpt->icao_] = arpt;
             jetways.clear();
             arpt->ComputeBBox();  // compute bounding box for this airport
@@ -284,8 +330,6 @@ static bool ParseAptDat(const std::string& fn, bool ignore) {
         if (line.starts_with("1500 ")) {
             Jetway jw;
             sscanf(line.c_str(), "%*d %lf %lf %f %*d %*d %*f %f", &jw.pos.lat, &jw.pos.lon, &jw.hdgt, &jw.length);
-            fem::Vec2 dir{cosf((90.0f - jw.hdgt) * kD2R), sinf((90.0f - jw.hdgt) * kD2R)};
-            jw.cabin = jw.pos + jw.length * dir;
             jetways.push_back(jw);
             continue;
         }
@@ -301,13 +345,7 @@ static bool ParseAptDat(const std::string& fn, bool ignore) {
                        &rwy.width, name1, &rwy.end1.lat, &rwy.end1.lon, name2, &rwy.end2.lat, &rwy.end2.lon);
             if (n == 7) {
                 rwy.name = std::string(name1) + "/" + std::string(name2);
-                rwy.cl = rwy.end2 - rwy.end1;  // center line vector
-                rwy.len = fem::len(rwy.cl);
-                if (rwy.len < 1.0) {
-                    LogMsg("Runway '%s' too short: %0.1f", rwy.name.c_str(), rwy.len);
-                    continue;
-                }
-                rwy.cl = (1 / rwy.len) * rwy.cl;  // normalize
+                // local coordinates and center line are set up in SetupFrame()
                 arpt->rwys_.push_back(rwy);
             }
             continue;
@@ -373,15 +411,18 @@ const AptAirport* AptAirport::LookupAirport(const std::string& airport_id) {
 }
 
 // Locate airport from position -> id
-const std::string AptAirport::LocateAirport(const fem::LLPos& pos) {
+const std::string& AptAirport::LocateAirport(const fem::LLPos& pos) {
+    static const std::string not_found;
+
     for (const auto& [n, a] : apt_airports) {
         if (a->ignore_)
             continue;
 #if 0
         // keep in case we want to use runways
         // check if we are on a runway
+        const fem::Vec2f pos_l = a->frame_.ToLocal(pos);
         for (const auto& r : a->rwys_) {
-            fem::Vec2 pos_end1 = pos - r.end1;
+            fem::Vec2f pos_end1 = pos_l - r.p1;
             auto proj = pos_end1 * r.cl;
             //LogMsg("proj: %f, runway: %s", proj, r.name.c_str());
             if (proj < 0.0 || proj > r.len)
@@ -401,5 +442,5 @@ const std::string AptAirport::LocateAirport(const fem::LLPos& pos) {
     }
 
     LogMsg("sorry, %0.8f,%0.8f is not on an AutoDGS airport", pos.lat, pos.lon);
-    return "";  // not found
+    return not_found;
 }
@@ -36,6 +36,10 @@
 #include "autodgs.h"
 #include "airport.h"
 #include "plane.h"
+#include "scheduler.h"
+#include "instance_pool.h"
+#include "stand_cfg_store.h"
+#include "file_writer.h"
 
 #include "XPLMPlugin.h"
 #include "XPLMProcessing.h"
@@ -56,6 +60,7 @@ std::string sys_cfg_dir;    // <base_dir>/cfg
 std::string user_cfg_dir;   // <xp_dir>/Output/AutoDGS
 
 opmode_t operation_mode = MODE_AUTO;
+int stream_radius = kStreamRadiusDefault;
 XPLMCommandRef cycle_dgs_cmdr, move_dgs_closer_cmdr, activate_cmdr,
     toggle_ui_cmdr, toggle_jetway_cmdr;
 
@@ -64,12 +69,18 @@ XPLMDataRef plane_lat_dr, plane_lon_dr, plane_elevation_dr, plane_true_psi_dr;
 XPLMDataRef gear_fnrml_dr, acf_cg_y_dr, acf_cg_z_dr, gear_z_dr;
 XPLMDataRef beacon_dr, parkbrake_dr, acf_icao_dr, total_running_time_sec_dr;
 XPLMDataRef percent_lights_dr, ev100_dr, xp_version_dr, eng_running_dr, sin_wave_dr;
-XPLMDataRef vr_enabled_dr, ground_speed_dr;
+XPLMDataRef vr_enabled_dr, ground_speed_dr, view_x_dr, view_z_dr;
 static XPLMDataRef zulu_time_minutes_dr, zulu_time_hours_dr;
 XPLMProbeRef probe_ref;
 XPLMObjectRef dgs_obj[2], pole_base_obj;
 
-static fem::LLPos plane_pos;       // current plane position, updated in FlightLoopCb()
+// the objects are loaded asynchronously, nothing is instanced before all of them have arrived
+static constexpr int kNumObj = 3;   // dgs_obj[0], dgs_obj[1], pole_base_obj
+static std::string obj_path[kNumObj];
+static int n_obj_pending;
+static bool objs_ready;
+
+static fem::LLPos plane_pos;       // current plane position, updated in PlaneJob()
 static fem::LLPos plane_pos_prev;  // previous plane position
 
 // track reference frame generation number
@@ -109,16 +120,22 @@ const char *dgs_dlist_dr[] = {
     NULL
 };
 
-static float time_utc_m0, time_utc_m1, time_utc_h0, time_utc_h1, vdgs_brightness;
+// Derived datarefs read by the VDGS objects. They are computed on a read and then reused for
+// kDerivedFrames frames, so nothing is computed unless an instance is actually drawn.
+static constexpr int kDerivedFrames = 30;
+static float time_utc[4], vdgs_brightness;   // m0, m1, h0, h1
+static int time_utc_cycle = -kDerivedFrames, vdgs_brightness_cycle = -kDerivedFrames;
+static int n_time_utc_calc, n_vdgs_brightness_calc;
 
-static float FlightLoopCb(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter,
-                          void* inRefcon);
+// scheduler jobs
+static int plane_job;
+static bool pending_plane_loaded_cb = false;  // delayed init
 
-static XPLMCreateFlightLoop_t flight_loop_ctx = {sizeof(XPLMCreateFlightLoop_t),
-                                                 xplm_FlightLoop_Phase_BeforeFlightModel, FlightLoopCb, nullptr};
+static constexpr float kPlaneJobPeriod = 0.5;       // s
+static constexpr float kOnGroundDebounce = 10.0;    // s
+static constexpr float kIdlePeriod = 2.0;           // s, watch ground contact and an idle airport
 
-static XPLMFlightLoopID flight_loop_id;
-static bool pending_plane_loaded_cb = false;  // delayed init
+static constexpr int kPoolPrecreate = 8;            // VDGS + pole instances created at startup
 
 //------------------------------------------------------------------------------------
 
@@ -132,9 +149,16 @@ void Activate(void) {
     if (arpt && arpt->state() > Airport::INACTIVE)
         return;
 
+    if (!objs_ready) {
+        LogMsg("objects are not loaded yet");
+        return;
+    }
+
     plane.ResetBeacon();
 
-    std::string airport_id = AptAirport::LocateAirport(plane_pos);
+    // may have been skipped while idle
+    plane_pos = fem::LLPos(XPLMGetDataf(plane_lat_dr), XPLMGetDataf(plane_lon_dr));
+    const std::string& airport_id = AptAirport::LocateAirport(plane_pos);
     if (!airport_id.empty()) {
         LogMsg("now on airport: %s", airport_id.c_str());
         if (arpt == nullptr || arpt->name() != airport_id) {  // don't reload same
@@ -148,12 +172,35 @@ void Activate(void) {
     if (arpt == nullptr)
         return;
 
-    arpt->ResetState(plane.BeaconOn() ? Airport::ARRIVAL : Airport::INACTIVE);
+    arpt->ResetState(plane.BeaconOn(Snapshot::Take()) ? Airport::ARRIVAL : Airport::INACTIVE);
     LogMsg("airport loaded: '%s', new state: %s", arpt->name().c_str(), Airport::state_str[arpt->state()]);
     UpdateUI();
 }
 
-// Dataref accessor, only called for the _utc_ datarefs
+// callback of XPLMLoadObjectAsync, ref is the index into obj_path
+static void ObjLoadedCb(XPLMObjectRef obj, void* ref) {
+    int i = (intptr_t)ref;
+    n_obj_pending--;
+
+    if (obj == nullptr) {
+        LogMsg("error loading obj: %s", obj_path[i].c_str());
+        error_disabled = true;
+        return;
+    }
+
+    (i < 2 ? dgs_obj[i] : pole_base_obj) = obj;
+    if (n_obj_pending > 0 || error_disabled)
+        return;
+
+    static const char* null_dlist[] = {nullptr};
+    dgs_pool[kMarshaller].Init(dgs_obj[kMarshaller], dgs_dlist_dr, 1);
+    dgs_pool[kVDGS].Init(dgs_obj[kVDGS], dgs_dlist_dr, kPoolPrecreate);
+    pole_base_pool.Init(pole_base_obj, null_dlist, kPoolPrecreate);
+    objs_ready = true;
+    LogMsg("all objects loaded");
+}
+
+// Dataref accessor, only called for the instanced datarefs
 static float GetDgsFloat(void* ref) {
     if (ref == nullptr)
         return -1.0f;
@@ -161,88 +208,111 @@ static float GetDgsFloat(void* ref) {
     return *(float*)ref;
 }
 
-static float FlightLoopCb(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter,
-                          void* inRefcon) {
-    static float on_ground_ts;  // debounce ground contact
+// plane position, teleportation and ground contact
+static float PlaneJob() {
+    static float plane_job_ts;
 
-    try {
-        if (pending_plane_loaded_cb) {
-            plane.PlaneLoadedCb();
-            pending_plane_loaded_cb = false;
-        }
+    if (pending_plane_loaded_cb) {
+        plane.PlaneLoadedCb();
+        pending_plane_loaded_cb = false;
+    }
 
-        plane_pos_prev = plane_pos;
-        plane_pos = fem::LLPos(XPLMGetDataf(plane_lat_dr), XPLMGetDataf(plane_lon_dr));
+    // ground contact is picked up once the objects are there
+    if (!objs_ready)
+        return kPlaneJobPeriod;
 
-        // if we go 3 * supersonic it's a teleportation, e.g. a ToLiss situation reload
-        if (fem::len(plane_pos - plane_pos_prev) > inElapsedSinceLastCall * 3.0f * 340.0f) {
-            LogMsg("teleportation detected, resetting airport");
-            arpt = nullptr;
-        }
+    int og;
+    if (plane.is_helicopter)
+        og = (XPLMGetDataf(y_agl_dr) < 10.0);
+    else
+        og = (XPLMGetDataf(gear_fnrml_dr) != 0.0);
 
-        float loop_delay = 2.0;
-
-        now = XPLMGetDataf(total_running_time_sec_dr);
-        int og;
-        if (plane.is_helicopter)
-            og = (XPLMGetDataf(y_agl_dr) < 10.0);
-        else
-            og = (XPLMGetDataf(gear_fnrml_dr) != 0.0);
-
-        if (og != on_ground && now > on_ground_ts + 10.0) {
-            on_ground = og;
-            on_ground_ts = now;
-            LogMsg("transition to on_ground: %d", on_ground);
-
-            if (on_ground) {
-                if (operation_mode == MODE_AUTO)
-                    Activate();
-            } else {
-                // transition to airborne
-                arpt = nullptr;
-            }
-        }
+    // without an airport a teleportation does not matter, ground contact is the only thing to watch
+    if (arpt == nullptr && og == on_ground)
+        return kIdlePeriod;
 
-        if (arpt)
-            loop_delay = arpt->StateMachine();
-
-        // update global dataref values
-
-        // brightness for VDGS
-        static constexpr float min_brightness = 0.025;  // relative to 1
-
-        if (ev100_dr) {
-            // if ev100 is available, we use it to set brightness
-            static constexpr float kMinEv100 = 6.0f;
-            static constexpr float kMaxEv100 = 11.0f;
-            float ev100 = XPLMGetDataf(ev100_dr);
-            ev100 = std::clamp(ev100, kMinEv100, kMaxEv100);
-            const float f = (ev100 - kMinEv100) / (kMaxEv100 - kMinEv100);
-            // ev100 is logarithmic and vdgs_brightness linear, so we use exp here
-            const float exp_f = (std::exp(f) - 1.0f) / (std::exp(1.0f) - 1.0f);
-            vdgs_brightness = min_brightness + (1.0f - min_brightness) * exp_f;
-            // LogMsg("ev100: %0.2f, vdgs_brightness: %0.3f", ev100, vdgs_brightness);
-        } else {
-            // fallback: use percent_lights_on
-            vdgs_brightness =
-                min_brightness + (1.0f - min_brightness) * std::pow(1.0f - XPLMGetDataf(percent_lights_dr), 6.0f);
-        }
+    plane_pos_prev = plane_pos;
+    plane_pos = fem::LLPos(XPLMGetDataf(plane_lat_dr), XPLMGetDataf(plane_lon_dr));
+
+    // if we go 3 * supersonic it's a teleportation, e.g. a ToLiss situation reload
+    if (fem::len(plane_pos - plane_pos_prev) > (now - plane_job_ts) * 3.0f * 340.0f) {
+        LogMsg("teleportation detected, resetting airport");
+        arpt = nullptr;
+    }
+
+    plane_job_ts = now;
+
+    // the jobs of an idle airport sleep, we are the only watch
+    if (arpt && arpt->idle())
+        arpt->Watch(plane_pos);
+
+    if (og == on_ground)
+        return (arpt && !arpt->idle()) ? kPlaneJobPeriod : kIdlePeriod;
+
+    on_ground = og;
+    LogMsg("transition to on_ground: %d", on_ground);
 
-        // UTC time digits
+    if (on_ground) {
+        if (operation_mode == MODE_AUTO)
+            Activate();
+    } else {
+        // transition to airborne
+        arpt = nullptr;
+    }
+
+    return kOnGroundDebounce;  // debounce ground contact
+}
+
+// true if a derived value last computed in cycle must be recomputed
+static bool DerivedDue(int& cycle) {
+    int c = XPLMGetCycleNumber();
+    if (cycle <= c && c < cycle + kDerivedFrames)
+        return false;
+
+    cycle = c;
+    return true;
+}
+
+static float GetVdgsBrightness([[maybe_unused]] void* ref) {
+    if (!DerivedDue(vdgs_brightness_cycle))
+        return vdgs_brightness;
+
+    n_vdgs_brightness_calc++;
+    static constexpr float min_brightness = 0.025;  // relative to 1
+
+    if (ev100_dr) {
+        // if ev100 is available, we use it to set brightness
+        static constexpr float kMinEv100 = 6.0f;
+        static constexpr float kMaxEv100 = 11.0f;
+        float ev100 = XPLMGetDataf(ev100_dr);
+        ev100 = std::clamp(ev100, kMinEv100, kMaxEv100);
+        const float f = (ev100 - kMinEv100) / (kMaxEv100 - kMinEv100);
+        // ev100 is logarithmic and vdgs_brightness linear, so we use exp here
+        const float exp_f = (std::exp(f) - 1.0f) / (std::exp(1.0f) - 1.0f);
+        vdgs_brightness = min_brightness + (1.0f - min_brightness) * exp_f;
+        // LogMsg("ev100: %0.2f, vdgs_brightness: %0.3f", ev100, vdgs_brightness);
+    } else {
+        // fallback: use percent_lights_on
+        vdgs_brightness =
+            min_brightness + (1.0f - min_brightness) * std::pow(1.0f - XPLMGetDataf(percent_lights_dr), 6.0f);
+    }
+
+    return vdgs_brightness;
+}
+
+// ref is the index into time_utc
+static float GetTimeUtc(void* ref) {
+    if (DerivedDue(time_utc_cycle)) {
+        n_time_utc_calc++;
         int zm = XPLMGetDatai(zulu_time_minutes_dr);
         int zh = XPLMGetDatai(zulu_time_hours_dr);
-        time_utc_m0 = zm % 10;
-        time_utc_m1 = zm / 10;
-        time_utc_h0 = zh % 10;
-        time_utc_h1 = zh / 10;
-
-        return loop_delay;
-    } catch (const std::exception& ex) {
-        LogMsg("fatal error: '%s'", ex.what());  // hopefully LogMsg is still alive
-        LogMsg("disabling plugin to avoid further errors and hopefully protect X-Plane from crashing");
-        error_disabled = true;
-        return 0;
+        time_utc[0] = zm % 10;
+        time_utc[1] = zm / 10;
+        time_utc[2] = zh % 10;
+        time_utc[3] = zh / 10;
     }
+
+    return time_utc[(intptr_t)ref];
 }
 
 // call backs for commands
@@ -279,6 +349,19 @@ static void MenuCb([[maybe_unused]] void* menu_ref, void* item_ref) {
     XPLMCommandOnce(*(XPLMCommandRef*)item_ref);
 }
 
+Snapshot Snapshot::Take() {
+    Snapshot snap;
+    snap.now = ::now;
+    snap.plane_x = XPLMGetDataf(plane_x_dr);
+    snap.plane_z = XPLMGetDataf(plane_z_dr);
+    snap.plane_hdgt = XPLMGetDataf(plane_true_psi_dr);
+    snap.ground_speed = XPLMGetDataf(ground_speed_dr);
+    snap.sin_wave = XPLMGetDataf(sin_wave_dr);
+    snap.beacon = XPLMGetDatai(beacon_dr);
+    snap.parkbrake_set = (XPLMGetDataf(parkbrake_dr) > 0.5);
+    return snap;
+}
+
 // check for shift of reference frame
 void CheckRefFrameShift() {
     // check for shift of reference frame
@@ -319,6 +402,8 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc) {
         return 0;
     }
 
+    stand_cfg_store.Open(user_cfg_dir + "stand_cfg.idx", {user_cfg_dir, sys_cfg_dir});
+
     // Datarefs
     xp_version_dr = XPLMFindDataRef("sim/version/xplane_internal_version");
     plane_x_dr = XPLMFindDataRef("sim/flightmodel/position/local_x");
@@ -342,6 +427,8 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc) {
     percent_lights_dr = XPLMFindDataRef("sim/graphics/scenery/percent_lights_on");
     sin_wave_dr = XPLMFindDataRef("sim/graphics/animation/sin_wave_2");
     ground_speed_dr = XPLMFindDataRef("sim/flightmodel/position/groundspeed");
+    view_x_dr = XPLMFindDataRef("sim/graphics/view/view_x");
+    view_z_dr = XPLMFindDataRef("sim/graphics/view/view_z");
     zulu_time_minutes_dr = XPLMFindDataRef("sim/cockpit2/clock_timer/zulu_time_minutes");
     zulu_time_hours_dr = XPLMFindDataRef("sim/cockpit2/clock_timer/zulu_time_hours");
     lat_ref_dr = XPLMFindDataRef("sim/flightmodel/position/lat_ref");
@@ -353,16 +440,13 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc) {
                                  NULL, NULL, NULL, NULL, NULL, (void*)0, 0);
 
     // these are served globally
-    XPLMRegisterDataAccessor("AutoDGS/dgs/time_utc_m0", xplmType_Float, 0, NULL, NULL, GetDgsFloat, NULL, NULL, NULL,
-                             NULL, NULL, NULL, NULL, NULL, NULL, &time_utc_m0, 0);
-    XPLMRegisterDataAccessor("AutoDGS/dgs/time_utc_m1", xplmType_Float, 0, NULL, NULL, GetDgsFloat, NULL, NULL, NULL,
-                             NULL, NULL, NULL, NULL, NULL, NULL, &time_utc_m1, 0);
-    XPLMRegisterDataAccessor("AutoDGS/dgs/time_utc_h0", xplmType_Float, 0, NULL, NULL, GetDgsFloat, NULL, NULL, NULL,
-                             NULL, NULL, NULL, NULL, NULL, NULL, &time_utc_h0, 0);
-    XPLMRegisterDataAccessor("AutoDGS/dgs/time_utc_h1", xplmType_Float, 0, NULL, NULL, GetDgsFloat, NULL, NULL, NULL,
-                             NULL, NULL, NULL, NULL, NULL, NULL, &time_utc_h1, 0);
-    XPLMRegisterDataAccessor("AutoDGS/dgs/vdgs_brightness", xplmType_Float, 0, NULL, NULL, GetDgsFloat, NULL, NULL,
-                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, &vdgs_brightness, 0);
+    static const char* time_utc_dr[4] = {"AutoDGS/dgs/time_utc_m0", "AutoDGS/dgs/time_utc_m1",
+                                          "AutoDGS/dgs/time_utc_h0", "AutoDGS/dgs/time_utc_h1"};
+    for (intptr_t i = 0; i < 4; i++)
+        XPLMRegisterDataAccessor(time_utc_dr[i], xplmType_Float, 0, NULL, NULL, GetTimeUtc, NULL, NULL, NULL, NULL,
+                                 NULL, NULL, NULL, NULL, NULL, (void*)i, 0);
+    XPLMRegisterDataAccessor("AutoDGS/dgs/vdgs_brightness", xplmType_Float, 0, NULL, NULL, GetVdgsBrightness, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0);
 
     create_api_drefs();
     int is_XP11 = (XPLMGetDatai(xp_version_dr) < 120000);
@@ -377,22 +461,13 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc) {
         obj_name[1] = "Safedock-T2-24-pole.obj";
     }
 
-    for (int i = 0; i < 2; i++) {
-        std::string on = base_dir + "resources/" + obj_name[i];
-        dgs_obj[i] = XPLMLoadObject(on.c_str());
-
-        if (dgs_obj[i] == NULL) {
-            LogMsg("error loading obj: %s", on.c_str());
-            return 0;
-        }
-    }
-
-    std::string on = base_dir + "resources/pole_base.obj";
-    pole_base_obj = XPLMLoadObject(on.c_str());
-    if (pole_base_obj == NULL) {
-        LogMsg("error loading obj: %s", on.c_str());
-        return 0;
-    }
+    // don't hold up X-Plane's load sequence with disk and texture I/O, see ObjLoadedCb()
+    obj_path[0] = base_dir + "resources/" + obj_name[0];
+    obj_path[1] = base_dir + "resources/" + obj_name[1];
+    obj_path[2] = base_dir + "resources/pole_base.obj";
+    n_obj_pending = kNumObj;
+    for (intptr_t i = 0; i < kNumObj; i++)
+        XPLMLoadObjectAsync(obj_path[i].c_str(), ObjLoadedCb, (void*)i);
 
     // own commands
     cycle_dgs_cmdr = XPLMCreateCommand("AutoDGS/cycle_dgs", "Cycle DGS between Marshaller, VDGS");
@@ -420,12 +495,30 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc) {
     // foreign commands
     toggle_jetway_cmdr = XPLMFindCommand("sim/ground_ops/jetway");
 
-    flight_loop_id = XPLMCreateFlightLoop(&flight_loop_ctx);
+    // nothing runs before the plane is loaded
+    scheduler.Start();
+    file_writer.Start();    // last, XPluginStop() is not called if we fail
+    plane_job = scheduler.Add("plane", 0.1f, -1.0f, PlaneJob);
     return 1;
 }
 
 PLUGIN_API void XPluginStop(void) {
-    XPLMUnregisterFlightLoopCallback(FlightLoopCb, NULL);
+    scheduler.Stop();
+    // drain the writer before the config store is closed,
+    // Close() stamps the index with the mtimes of the .cfg files on disk
+    file_writer.Stop();
+    LogMsg("derived datarefs computed: vdgs_brightness: %d, time_utc: %d times in %0.0f s", n_vdgs_brightness_calc,
+           n_time_utc_calc, XPLMGetDataf(total_running_time_sec_dr));
+
+    LogMsg("instance pushes: %d, skipped as unchanged: %d", n_push, n_push_skipped);
+    if (n_obj_pending > 0)
+        LogMsg("stopped with %d objects still loading", n_obj_pending);
+
+    dgs_pool[kMarshaller].Clear("Marshaller");
+    dgs_pool[kVDGS].Clear("VDGS");
+    pole_base_pool.Clear("pole base");
+    stand_cfg_store.Close();
+
     for (int i = 0; i < 2; i++)
         if (dgs_obj[i])
             XPLMUnloadObject(dgs_obj[i]);
@@ -458,9 +551,9 @@ PLUGIN_API void XPluginReceiveMessage([[maybe_unused]] XPLMPluginID in_from, lon
         LogMsg("plane loaded, resetting airport");
         arpt = nullptr;
         on_ground = 0;
-        XPLMScheduleFlightLoop(flight_loop_id, 0, 0);
         pending_plane_loaded_cb = true;
-        XPLMScheduleFlightLoop(flight_loop_id, 15.0, 1);  // let the dust settle
+        // let the dust settle
+        scheduler.Schedule(plane_job, 15.0f);
         return;
     }
 
@@ -20,8 +20,12 @@
 //    USA
 //
 
+#ifndef _AUTODGS_H_
+#define _AUTODGS_H_
+
 #include <cmath>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <numbers>
 #include <vector>
@@ -45,6 +49,12 @@ static constexpr int kMarshaller = 0;
 static constexpr int kVDGS = 1;
 static constexpr int kAutomatic = 2;
 
+static constexpr float kDgsMinDist = 8.0;           // m, valid range of dgs_dist
+static constexpr float kDgsMaxDist = 30.0;
+
+static constexpr int kStreamRadiusDefault = 3000;   // m, see stream_radius
+static constexpr int kStreamRadiusMin = 500;
+
 typedef enum
 {
     MODE_AUTO,
@@ -90,6 +100,7 @@ struct AptStand {
 	std::string name;
 	double lon, lat;
 	float hdgt;
+    fem::Vec2f pos;     // in the airport's local frame
     bool has_jw{false};
 };
 
@@ -97,8 +108,9 @@ struct AptStand {
 struct AptRunway {
     std::string name;
     fem::LLPos end1, end2;
-    fem::Vec2 cl;   // center line unit vector, end1 -> end2
-    double len;
+    fem::Vec2f p1, p2;  // end1, end2 in the airport's local frame
+    fem::Vec2f cl;      // center line unit vector, end1 -> end2
+    float len;
     float width;
 };
 
@@ -109,16 +121,21 @@ class AptAirport {
     public:
     static bool CollectAirports(const std::string& xp_dir);
     static const AptAirport *LookupAirport(const std::string& airport_id);
-    static const std::string LocateAirport(const fem::LLPos& pos);
+    static const std::string& LocateAirport(const fem::LLPos& pos);  // "": not found
 
     std::string icao_;
+    fem::LocalFrame frame_;     // all local coordinates of stands_ and rwys_ are in this frame
     bool has_twr_{false};
     bool ignore_{false};		// e.g. sam or no_autodgs marker present
     std::vector<AptStand> stands_;
     std::vector<AptRunway> rwys_;
     AptAirport(const std::string& name) : icao_(name) {}
     void dump() const;
+    void SetupFrame();
     void ComputeBBox();
+
+    // stands_ are sorted by name, duplicates in apt.dat order -> [first, last) of the stands named name
+    std::pair<int, int> FindStands(std::string_view name) const;
 };
 
 extern bool error_disabled;
@@ -133,16 +150,30 @@ extern XPLMDataRef plane_lat_dr, plane_lon_dr, plane_elevation_dr, plane_true_ps
 extern XPLMDataRef gear_fnrml_dr, acf_cg_y_dr, acf_cg_z_dr, gear_z_dr;
 extern XPLMDataRef beacon_dr, parkbrake_dr, acf_icao_dr, total_running_time_sec_dr;
 extern XPLMDataRef percent_lights_dr, ev100_dr, xp_version_dr, eng_running_dr, sin_wave_dr;
-extern XPLMDataRef ground_speed_dr;
+extern XPLMDataRef ground_speed_dr, view_x_dr, view_z_dr;
 extern XPLMCommandRef cycle_dgs_cmdr, move_dgs_closer_cmdr, activate_cmdr,
     toggle_ui_cmdr, toggle_jetway_cmdr;
 extern XPLMProbeRef probe_ref;
 extern XPLMObjectRef dgs_obj[2], pole_base_obj;
 
 extern opmode_t operation_mode;
+extern int stream_radius;   // m, VDGS instances exist only for stands within this distance to the camera
 extern float now;           // current timestamp
 extern int on_ground;
 
+// The sim datarefs a job's decisions are based on, read once at the start of the run
+// and passed down so all parts see the same consistent values.
+struct Snapshot {
+    float now;
+    float plane_x, plane_z, plane_hdgt;     // local frame, true heading
+    float ground_speed;
+    float sin_wave;
+    int beacon;                             // raw switch position
+    bool parkbrake_set;
+
+    static Snapshot Take();
+};
+
 void CheckRefFrameShift();
 extern int ref_gen;
 
@@ -150,3 +181,5 @@ extern void create_api_drefs();
 extern void ToggleUI(void);
 extern void UpdateUI(bool only_if_visible = true);
 extern void Activate(void);
+
+#endif
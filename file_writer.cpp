@@ -0,0 +1,188 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "autodgs.h"
+#include "file_writer.h"
+
+FileWriter file_writer;
+
+std::string FileWriter::WriteFile(const std::string& path, const std::string& content) {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!f.is_open())
+            return "Can't create '" + tmp_path + "'";
+
+        f.write(content.data(), content.size());
+        if (!f.good())
+            return "Error writing '" + tmp_path + "'";
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+        return "Can't rename '" + tmp_path + "': " + ec.message();
+
+    return "";
+}
+
+std::string FileWriter::ReadFile(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open())
+        return "";
+
+    std::ostringstream content;
+    content << f.rdbuf();
+    return std::move(content).str();
+}
+
+// with mutex_ held
+bool FileWriter::ReadsPending() {
+    return std::any_of(reads_.begin(), reads_.end(), [](auto const& r) { return !r.second.done; });
+}
+
+// the writer thread, must not call any XPLM function (including LogMsg)
+void FileWriter::Run() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stop_ || !pending_.empty() || ReadsPending(); });
+        if (pending_.empty() && !ReadsPending())
+            return;     // stop_ and all is written
+
+        auto work = std::move(pending_);
+        pending_.clear();
+
+        std::vector<std::string> read_paths;
+        for (auto const& [path, r] : reads_)
+            if (!r.done)
+                read_paths.push_back(path);
+
+        lock.unlock();
+        std::vector<std::string> errors;
+        for (auto const& [path, content] : work) {
+            std::string err = WriteFile(path, content);
+            if (!err.empty())
+                errors.push_back(std::move(err));
+        }
+
+        // after the writes so a read sees what was requested before it
+        std::vector<std::string> read_contents;
+        for (auto const& path : read_paths)
+            read_contents.push_back(ReadFile(path));
+        lock.lock();
+
+        n_written_ += work.size() - errors.size();
+        errors_.insert(errors_.end(), errors.begin(), errors.end());
+
+        for (int i = 0; i < (int)read_paths.size(); i++) {
+            auto it = reads_.find(read_paths[i]);
+            if (it != reads_.end())
+                it->second = {true, std::move(read_contents[i])};
+        }
+    }
+}
+
+void FileWriter::LogErrors() {
+    std::vector<std::string> errors;
+    {
+        std::lock_guard lock(mutex_);
+        errors.swap(errors_);
+    }
+
+    for (auto const& e : errors)
+        LogMsg("%s", e.c_str());
+}
+
+void FileWriter::Start() {
+    stop_ = false;
+    thread_ = std::thread(&FileWriter::Run, this);
+}
+
+void FileWriter::Stop() {
+    if (!thread_.joinable())
+        return;
+
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+
+    LogErrors();
+    LogMsg("file writer: writes requested: %d, coalesced: %d, written: %d", n_requested_, n_coalesced_, n_written_);
+}
+
+void FileWriter::Write(const std::string& path, std::string content) {
+    LogErrors();    // of previous writes
+    n_requested_++;
+
+    if (!thread_.joinable()) {
+        std::string err = WriteFile(path, content);
+        if (!err.empty())
+            LogMsg("%s", err.c_str());
+        else
+            n_written_++;
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        auto [it, inserted] = pending_.insert_or_assign(path, std::move(content));
+        if (!inserted)
+            n_coalesced_++;
+    }
+    cv_.notify_one();
+}
+
+void FileWriter::Read(const std::string& path) {
+    if (!thread_.joinable()) {
+        reads_[path] = {true, ReadFile(path)};
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        reads_[path] = {false, ""};
+    }
+    cv_.notify_one();
+}
+
+bool FileWriter::Fetch(const std::string& path, std::string& content) {
+    std::lock_guard lock(mutex_);
+    auto it = reads_.find(path);
+    if (it == reads_.end()) {
+        content.clear();
+        return true;
+    }
+
+    if (!it->second.done)
+        return false;
+
+    content = std::move(it->second.content);
+    reads_.erase(it);
+    return true;
+}
@@ -0,0 +1,80 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#ifndef _FILE_WRITER_H_
+#define _FILE_WRITER_H_
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes files on a background thread so disk latency never lands in a sim frame.
+// A write of a file that is still pending replaces the pending content.
+// Files are written to a temp file that is renamed, so a reader sees either the old or the new file.
+// Files can be read on the thread as well, a read comes after the writes requested before it.
+class FileWriter {
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    struct ReadResult {
+        bool done;
+        std::string content;
+    };
+
+    // protected by mutex_
+    std::map<std::string, std::string> pending_;    // path -> content
+    std::map<std::string, ReadResult> reads_;       // path -> result
+    std::vector<std::string> errors_;               // for LogMsg() on the main thread
+    bool stop_;
+    int n_written_;
+
+    // main thread only
+    int n_requested_, n_coalesced_;
+
+    static std::string WriteFile(const std::string& path, const std::string& content);  // -> error or ""
+    static std::string ReadFile(const std::string& path);   // -> content or "" if it can't be read
+    bool ReadsPending();
+    void Run();
+    void LogErrors();
+
+  public:
+    FileWriter() : stop_(false), n_written_(0), n_requested_(0), n_coalesced_(0) {}
+
+    void Start();
+    void Stop();    // write what is pending and end the thread
+    bool running() const { return thread_.joinable(); }
+
+    // without a running thread the file is written right away
+    void Write(const std::string& path, std::string content);
+
+    // without a running thread the file is read right away, the result is picked up by Fetch()
+    void Read(const std::string& path);
+
+    // -> false while the read is pending, else content is the file or "" if it can't be read
+    bool Fetch(const std::string& path, std::string& content);
+};
+
+extern FileWriter file_writer;
+#endif
@@ -34,10 +34,21 @@
 #define _FLAT_EARTH_MATH_
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 namespace flat_earth_math {
 
 static constexpr float kLat2m = 111120;             // 1° lat in m
+static constexpr double kDeg2Rad = 0.01745329252;
 
 // return relative angle in (-180, 180]
 static inline double RA(double angle) {
@@ -83,8 +94,8 @@ static inline Vec2 operator-(const LLPos& b, const LLPos& a) {
 
 // pos + vec
 static inline LLPos operator+(const LLPos &p, const Vec2& v) {
-	return {RA(p.lon + v.x / (kLat2m * cosf(p.lat * 0.01745329252))),
-			RA(p.lat + v.y / kLat2m)};
+	return {RA(p.lat + v.y / kLat2m),
+			RA(p.lon + v.x / (kLat2m * cosf(p.lat * 0.01745329252)))};  // LLPos(lat, lon)
 }
 
 // vec b - vec a
@@ -107,6 +118,50 @@ static inline double operator*(const Vec2& a, const Vec2& b) {
     return a.x * b.x + a.y * b.y;  // dot product
 }
 
+// single precision vector for use in a LocalFrame
+struct Vec2f {
+    float x, y;  // right, up
+};
+
+static inline float len(const Vec2f& v) {
+    return sqrtf(v.x * v.x + v.y * v.y);
+}
+
+static inline Vec2f operator-(const Vec2f& b, const Vec2f& a) {
+    return {b.x - a.x, b.y - a.y};
+}
+
+static inline Vec2f operator+(const Vec2f& a, const Vec2f& b) {
+    return {a.x + b.x, a.y + b.y};
+}
+
+static inline Vec2f operator*(float c, const Vec2f& v) {
+    return {c * v.x, c * v.y};
+}
+
+static inline float operator*(const Vec2f& a, const Vec2f& b) {
+    return a.x * b.x + a.y * b.y;  // dot product
+}
+
+// A vector space attached at a fixed reference point, e.g. an airport's center.
+// The scale factors are computed once so within the frame all math is plain float arithmetic.
+// Only the conversion from and to LLPos pays for the RA.
+struct LocalFrame {
+    LLPos ref;
+    double lon2m, lat2m;  // m per ° lon, lat
+
+    LocalFrame() = default;
+    LocalFrame(const LLPos& ref) : ref(ref), lon2m(kLat2m * cos(ref.lat * kDeg2Rad)), lat2m(kLat2m) {}
+
+    Vec2f ToLocal(const LLPos& p) const {
+        return {(float)(RA(p.lon - ref.lon) * lon2m), (float)((p.lat - ref.lat) * lat2m)};
+    }
+
+    LLPos ToLLPos(const Vec2f& v) const {
+        return {ref.lat + v.y / lat2m, RA(ref.lon + v.x / lon2m)};
+    }
+};
+
 // pos in rectangle defined by lower_left and upper_right
 static inline bool InRect(const LLPos& pos, const LLPos& lower_left, const LLPos& upper_right) {
     // cheap test before we do the more expensive RA
@@ -114,5 +169,186 @@ static inline bool InRect(const LLPos& pos, const LLPos& lower_left, const LLPos
             RA(pos.lon - upper_right.lon) < 0.0f);
 }
 
+//------------------------------------------------------------------------------------
+// Batch kernels
+//
+// The scalar functions above are fine for a few positions. For bulk work, e.g. building the DB or
+// testing all stands of an airport, the kernels below work on spans in SoA layout.
+// Geodetic coordinates (lon, lat) are always double, metric vectors and angles are float or double.
+// With gcc/clang the kernels use vector extensions, otherwise plain loops.
+// Everything is branchless, so results of the vector and scalar paths are identical.
+//
+namespace batch {
+
+#if defined(__GNUC__)
+#define FEM_SIMD 1
+#if defined(__AVX__)
+static constexpr int kSimdBytes = 32;
+#else
+static constexpr int kSimdBytes = 16;   // SSE2 and NEON, the common baseline
+#endif
+
+template <typename T>
+struct Simd {
+    static constexpr int kLanes = kSimdBytes / sizeof(T);
+    typedef T V __attribute__((vector_size(kSimdBytes)));
+
+    static V Load(const T* p) {
+        V v;
+        memcpy(&v, p, sizeof(V));
+        return v;
+    }
+
+    static void Store(T* p, const V& v) {
+        memcpy(p, &v, sizeof(V));
+    }
+};
+
+// double lanes for computations that need the precision of lon, lat
+typedef Simd<double>::V VD;
+static constexpr int kLanesD = Simd<double>::kLanes;
+
+// lane wise sqrt, the vector extensions have no operator for that
+template <typename V>
+static inline V SqrtV(V v) {
+    typedef std::remove_cvref_t<decltype(v[0])> T;
+    constexpr bool kF = std::is_same_v<T, float>;
+#if defined(__AVX__)
+    if constexpr (kF)
+        return (V)_mm256_sqrt_ps((__m256)v);
+    else
+        return (V)_mm256_sqrt_pd((__m256d)v);
+#elif defined(__SSE2__)
+    if constexpr (kF)
+        return (V)_mm_sqrt_ps((__m128)v);
+    else
+        return (V)_mm_sqrt_pd((__m128d)v);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    if constexpr (kF)
+        return (V)vsqrtq_f32((float32x4_t)v);
+    else
+        return (V)vsqrtq_f64((float64x2_t)v);
+#else
+    for (int k = 0; k < (int)(sizeof(V) / sizeof(T)); k++)
+        v[k] = std::sqrt(v[k]);
+    return v;
+#endif
+}
+
+static inline Simd<float>::V Sqrt(Simd<float>::V v) { return SqrtV(v); }
+static inline Simd<double>::V Sqrt(Simd<double>::V v) { return SqrtV(v); }
+#endif
+
+static inline float Sqrt(float v) { return std::sqrt(v); }
+static inline double Sqrt(double v) { return std::sqrt(v); }
+
+// return relative angle in (-180, 180], branchless
+// T is the element type, V is T or a vector of T
+template <typename T, typename V = T>
+static inline V RA(V angle) {
+    // round to nearest by adding and subtracting 1.5 * 2^mantissa_bits
+    constexpr T kMagic = std::is_same_v<T, float> ? T(12582912.0f) : T(6755399441055744.0);
+    V n = (angle * T(1.0 / 360.0) + kMagic) - kMagic;
+    V r = angle - T(360) * n;  // -> [-180, 180]
+    return r <= T(-180) ? r + T(360) : r;
+}
+
+// angle[i] = RA(angle[i])
+template <typename T>
+static inline void RA(std::span<T> angle) {
+    size_t i = 0;
+#ifdef FEM_SIMD
+    using S = Simd<T>;
+    for (; i + S::kLanes <= angle.size(); i += S::kLanes)
+        S::Store(&angle[i], RA<T, typename S::V>(S::Load(&angle[i])));
+#endif
+    for (; i < angle.size(); i++)
+        angle[i] = RA<T>(angle[i]);
+}
+
+// (x, y)[i] = (lon, lat)[i] - a
+template <typename T>
+static inline void Diff(const LLPos& a, std::span<const double> lon, std::span<const double> lat, std::span<T> x,
+                        std::span<T> y) {
+    const double lon2m = kLat2m * cos(a.lat * kDeg2Rad);
+    const double lat2m = kLat2m;
+    size_t i = 0;
+#ifdef FEM_SIMD
+    for (; i + kLanesD <= lon.size(); i += kLanesD) {
+        VD vx = RA<double, VD>(Simd<double>::Load(&lon[i]) - a.lon) * lon2m;
+        VD vy = RA<double, VD>(Simd<double>::Load(&lat[i]) - a.lat) * lat2m;
+        for (int k = 0; k < kLanesD; k++) {
+            x[i + k] = vx[k];
+            y[i + k] = vy[k];
+        }
+    }
+#endif
+    for (; i < lon.size(); i++) {
+        x[i] = RA<double>(lon[i] - a.lon) * lon2m;
+        y[i] = RA<double>(lat[i] - a.lat) * lat2m;
+    }
+}
+
+// (lon, lat)[i] = a + (x, y)[i]
+template <typename T>
+static inline void Offset(const LLPos& a, std::span<const T> x, std::span<const T> y, std::span<double> lon,
+                          std::span<double> lat) {
+    const double m2lon = 1.0 / (kLat2m * cos(a.lat * kDeg2Rad));
+    const double m2lat = 1.0 / kLat2m;
+    size_t i = 0;
+#ifdef FEM_SIMD
+    for (; i + kLanesD <= x.size(); i += kLanesD) {
+        VD vx, vy;
+        for (int k = 0; k < kLanesD; k++) {
+            vx[k] = x[i + k];
+            vy[k] = y[i + k];
+        }
+        Simd<double>::Store(&lon[i], RA<double, VD>(a.lon + vx * m2lon));
+        Simd<double>::Store(&lat[i], RA<double, VD>(a.lat + vy * m2lat));
+    }
+#endif
+    for (; i < x.size(); i++) {
+        lon[i] = RA<double>(a.lon + x[i] * m2lon);
+        lat[i] = RA<double>(a.lat + y[i] * m2lat);
+    }
+}
+
+// res[i] = len((x, y)[i])
+template <typename T>
+static inline void Len(std::span<const T> x, std::span<const T> y, std::span<T> res) {
+    size_t i = 0;
+#ifdef FEM_SIMD
+    using S = Simd<T>;
+    for (; i + S::kLanes <= x.size(); i += S::kLanes) {
+        typename S::V vx = S::Load(&x[i]);
+        typename S::V vy = S::Load(&y[i]);
+        S::Store(&res[i], Sqrt(vx * vx + vy * vy));
+    }
+#endif
+    for (; i < x.size(); i++)
+        res[i] = std::sqrt(x[i] * x[i] + y[i] * y[i]);
+}
+
+// res[i] = InRect((lon, lat)[i], lower_left, upper_right)
+static inline void InRect(const LLPos& lower_left, const LLPos& upper_right, std::span<const double> lon,
+                          std::span<const double> lat, std::span<uint8_t> res) {
+    size_t i = 0;
+#ifdef FEM_SIMD
+    for (; i + kLanesD <= lon.size(); i += kLanesD) {
+        VD vlon = Simd<double>::Load(&lon[i]);
+        VD vlat = Simd<double>::Load(&lat[i]);
+        auto m = (vlat >= lower_left.lat) & (vlat <= upper_right.lat) &
+                 (RA<double, VD>(vlon - lower_left.lon) > 0.0) & (RA<double, VD>(vlon - upper_right.lon) < 0.0);
+        for (int k = 0; k < kLanesD; k++)
+            res[i + k] = m[k] & 1;
+    }
+#endif
+    for (; i < lon.size(); i++)
+        res[i] = (lat[i] >= lower_left.lat) & (lat[i] <= upper_right.lat) &
+                 (RA<double>(lon[i] - lower_left.lon) > 0.0) & (RA<double>(lon[i] - upper_right.lon) < 0.0);
+}
+
+}   // namespace batch
+
 }	// namespace
 #endif
@@ -0,0 +1,237 @@
+//
+//    Accuracy tests and microbenchmark for the batch kernels of flat_earth_math
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "flat_earth_math.h"
+
+namespace fem = flat_earth_math;
+
+static int n_fail;
+
+static void Check(const char* what, double max_err, double limit) {
+    bool ok = (max_err <= limit);
+    printf("%-28s max_err: %10.3g, limit: %8.1g %s\n", what, max_err, limit, ok ? "ok" : "FAILED");
+    if (!ok)
+        n_fail++;
+}
+
+template <typename T>
+static void TestRA(double limit) {
+    std::vector<T> a;
+    for (double x = -1080.0; x <= 1080.0; x += 0.25)
+        a.push_back(x);
+
+    std::vector<T> r{a};
+    fem::batch::RA(std::span<T>(r));
+
+    double max_err = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!(-180.0 < r[i] && r[i] <= 180.0))
+            max_err = 1.0E10;  // out of range
+        max_err = std::max(max_err, std::abs((double)r[i] - fem::RA((double)a[i])));
+    }
+
+    Check(std::is_same_v<T, float> ? "RA<float>" : "RA<double>", max_err, limit);
+}
+
+// random positions within ~20 km around ref
+static void RandomPos(const fem::LLPos& ref, int n, std::vector<double>& lon, std::vector<double>& lat) {
+    std::mt19937 gen(4711);
+    std::uniform_real_distribution<double> d(-0.18, 0.18);
+    lon.resize(n);
+    lat.resize(n);
+    for (int i = 0; i < n; i++) {
+        lat[i] = ref.lat + d(gen);
+        lon[i] = fem::RA(ref.lon + d(gen));
+    }
+}
+
+template <typename T>
+static void TestDiffOffset(const fem::LLPos& ref, double limit_m) {
+    static constexpr int kN = 1001;  // odd to exercise the scalar tail
+    std::vector<double> lon, lat;
+    RandomPos(ref, kN, lon, lat);
+
+    std::vector<T> x(kN), y(kN);
+    fem::batch::Diff<T>(ref, lon, lat, x, y);
+
+    double max_err = 0.0;
+    for (int i = 0; i < kN; i++) {
+        fem::Vec2 v = fem::LLPos(lat[i], lon[i]) - ref;
+        max_err = std::max(max_err, fem::len(fem::Vec2{x[i] - v.x, y[i] - v.y}));
+    }
+
+    char what[100];
+    snprintf(what, sizeof(what), "Diff<%s> @%0.0f,%0.0f", std::is_same_v<T, float> ? "float" : "double", ref.lat,
+             ref.lon);
+    Check(what, max_err, limit_m);
+
+    std::vector<double> lon1(kN), lat1(kN);
+    fem::batch::Offset<T>(ref, x, y, lon1, lat1);
+
+    max_err = 0.0;
+    for (int i = 0; i < kN; i++) {
+        fem::LLPos p = ref + fem::Vec2{x[i], y[i]};
+        max_err = std::max(max_err, fem::len(fem::LLPos(lat1[i], lon1[i]) - p));
+    }
+
+    snprintf(what, sizeof(what), "Offset<%s> @%0.0f,%0.0f", std::is_same_v<T, float> ? "float" : "double", ref.lat,
+             ref.lon);
+    Check(what, max_err, limit_m);
+}
+
+template <typename T>
+static void TestLen(double limit) {
+    static constexpr int kN = 1003;
+    std::mt19937 gen(815);
+    std::uniform_real_distribution<double> d(-20000.0, 20000.0);
+    std::vector<T> x(kN), y(kN), l(kN);
+    for (int i = 0; i < kN; i++) {
+        x[i] = d(gen);
+        y[i] = d(gen);
+    }
+
+    fem::batch::Len<T>(x, y, l);
+
+    double max_err = 0.0;
+    for (int i = 0; i < kN; i++)
+        max_err = std::max(max_err, std::abs(l[i] - fem::len(fem::Vec2{x[i], y[i]})));
+
+    Check(std::is_same_v<T, float> ? "Len<float>" : "Len<double>", max_err, limit);
+}
+
+static void TestInRect(const fem::LLPos& ref) {
+    static constexpr int kN = 1001;
+    std::vector<double> lon, lat;
+    RandomPos(ref, kN, lon, lat);
+
+    const fem::LLPos ll{ref.lat - 0.1, fem::RA(ref.lon - 0.1)};
+    const fem::LLPos ur{ref.lat + 0.1, fem::RA(ref.lon + 0.1)};
+    std::vector<uint8_t> res(kN);
+    fem::batch::InRect(ll, ur, lon, lat, res);
+
+    int n_diff = 0;
+    for (int i = 0; i < kN; i++)
+        n_diff += (res[i] != fem::InRect(fem::LLPos(lat[i], lon[i]), ll, ur));
+
+    char what[100];
+    snprintf(what, sizeof(what), "InRect @%0.0f,%0.0f", ref.lat, ref.lon);
+    Check(what, n_diff, 0);
+}
+
+//------------------------------------------------------------------------------------
+template <typename F>
+static double Bench(F f) {
+    static constexpr int kRep = 2000;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kRep; i++)
+        f();
+    auto t_end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(t_end - t_start).count() / kRep * 1.0E6;  // µs per call
+}
+
+static void Benchmark() {
+    static constexpr int kN = 4096;
+    const fem::LLPos ref{50.03, 8.55};
+    std::vector<double> lon, lat;
+    RandomPos(ref, kN, lon, lat);
+    std::vector<float> x(kN), y(kN), l(kN);
+    std::vector<fem::Vec2> v(kN);
+    volatile double sink = 0.0;
+
+    printf("\nBenchmark, %d positions, µs per pass\n", kN);
+
+    double t_s = Bench([&] {
+        for (int i = 0; i < kN; i++)
+            v[i] = fem::LLPos(lat[i], lon[i]) - ref;
+        sink = v[kN / 2].x;
+    });
+    double t_b = Bench([&] {
+        fem::batch::Diff<float>(ref, lon, lat, x, y);
+        sink = x[kN / 2];
+    });
+    printf("%-20s scalar: %8.2f, batch: %8.2f, speedup: %4.1f\n", "Diff", t_s, t_b, t_s / t_b);
+
+    std::vector<double> a(kN), b(kN);
+    for (int i = 0; i < kN; i++)
+        a[i] = lon[i] * 7.0;
+    t_s = Bench([&] {
+        for (int i = 0; i < kN; i++)
+            b[i] = fem::RA(a[i]);
+        sink = b[kN / 2];
+    });
+    t_b = Bench([&] {
+        b = a;
+        fem::batch::RA(std::span<double>(b));
+        sink = b[kN / 2];
+    });
+    printf("%-20s scalar: %8.2f, batch: %8.2f, speedup: %4.1f\n", "RA", t_s, t_b, t_s / t_b);
+
+    t_s = Bench([&] {
+        for (int i = 0; i < kN; i++)
+            l[i] = fem::len(v[i]);
+        sink = l[kN / 2];
+    });
+    t_b = Bench([&] {
+        fem::batch::Len<float>(x, y, l);
+        sink = l[kN / 2];
+    });
+    printf("%-20s scalar: %8.2f, batch: %8.2f, speedup: %4.1f\n", "Len", t_s, t_b, t_s / t_b);
+
+    const fem::LLPos ll{ref.lat - 0.1, ref.lon - 0.1};
+    const fem::LLPos ur{ref.lat + 0.1, ref.lon + 0.1};
+    std::vector<uint8_t> res(kN);
+    t_s = Bench([&] {
+        for (int i = 0; i < kN; i++)
+            res[i] = fem::InRect(fem::LLPos(lat[i], lon[i]), ll, ur);
+        sink = res[kN / 2];
+    });
+    t_b = Bench([&] {
+        fem::batch::InRect(ll, ur, lon, lat, res);
+        sink = res[kN / 2];
+    });
+    printf("%-20s scalar: %8.2f, batch: %8.2f, speedup: %4.1f\n", "InRect", t_s, t_b, t_s / t_b);
+}
+
+int main() {
+    TestRA<float>(1.0E-4);
+    TestRA<double>(1.0E-9);
+
+    // the scalar version uses cosf so we can't expect better than a few mm at 20 km
+    for (auto ref : {fem::LLPos(50.03, 8.55), fem::LLPos(-33.94, 151.17), fem::LLPos(64.0, 179.99),
+                     fem::LLPos(21.3, -157.9)}) {
+        TestDiffOffset<double>(ref, 0.01);
+        TestDiffOffset<float>(ref, 0.01);
+        TestInRect(ref);
+    }
+
+    TestLen<float>(0.01);
+    TestLen<double>(1.0E-9);
+
+    Benchmark();
+
+    printf("\n%s, %d failures\n", n_fail ? "FAILED" : "PASSED", n_fail);
+    return n_fail ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+
+#include <algorithm>
+#include <cstring>
+
+#include "autodgs.h"
+#include "instance_pool.h"
+
+InstancePool dgs_pool[2], pole_base_pool;
+int n_push, n_push_skipped;
+
+void InstancePool::Init(XPLMObjectRef obj, const char **dlist, int n_precreate) {
+    obj_ = obj;
+    dlist_ = dlist;
+
+    int n = 0;
+    while (dlist_[n])
+        n++;
+    park_drefs_.assign(std::max(n, 1), 0.0f);
+
+    max_free_ = n_precreate;
+    free_.reserve(n_precreate);
+    for (int i = 0; i < n_precreate; i++) {
+        n_created_++;
+        Park(XPLMCreateInstance(obj_, dlist_));
+    }
+}
+
+void InstancePool::Clear(const char *name) {
+    for (auto inst_ref : free_)
+        XPLMDestroyInstance(inst_ref);
+    free_.clear();
+
+    if (n_out_ != 0)
+        LogMsg("pool '%s': %d instances not released", name, n_out_);
+    LogMsg("pool '%s': created: %d, reused: %d, destroyed on release: %d", name, n_created_, n_reused_,
+           n_destroyed_);
+}
+
+XPLMInstanceRef InstancePool::Acquire() {
+    n_out_++;
+    if (free_.empty()) {
+        n_created_++;
+        return XPLMCreateInstance(obj_, dlist_);
+    }
+
+    n_reused_++;
+    XPLMInstanceRef inst_ref = free_.back();
+    free_.pop_back();
+    return inst_ref;
+}
+
+void InstancePool::Release(XPLMInstanceRef inst_ref) {
+    n_out_--;
+    if ((int)free_.size() >= max_free_) {
+        n_destroyed_++;
+        XPLMDestroyInstance(inst_ref);
+        return;
+    }
+
+    Park(inst_ref);
+}
+
+void InstancePool::Park(XPLMInstanceRef inst_ref) {
+    // far below the ground it is never drawn
+    static const XPLMDrawInfo_t park = {.structSize = sizeof(XPLMDrawInfo_t), .y = -1.0E5f};
+    XPLMInstanceSetPosition(inst_ref, &park, park_drefs_.data());
+    free_.push_back(inst_ref);
+}
+
+void PushCache::SetPosition(XPLMInstanceRef inst_ref, const XPLMDrawInfo_t *drawinfo, const float *drefs) {
+    if (valid && memcmp(&this->drawinfo, drawinfo, sizeof(XPLMDrawInfo_t)) == 0 &&
+        (drefs == nullptr || memcmp(this->drefs, drefs, sizeof(this->drefs)) == 0)) {
+        n_push_skipped++;
+        return;
+    }
+
+    n_push++;
+    XPLMInstanceSetPosition(inst_ref, drawinfo, drefs);
+    valid = true;
+    this->drawinfo = *drawinfo;
+    if (drefs)
+        memcpy(this->drefs, drefs, sizeof(this->drefs));
+}
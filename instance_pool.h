@@ -0,0 +1,76 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+
+#ifndef _INSTANCE_POOL_H_
+#define _INSTANCE_POOL_H_
+
+#include <vector>
+
+#include "XPLMInstance.h"
+
+#include "autodgs.h"
+
+// Instances of one object are recycled rather than destroyed.
+// A released instance is parked out of sight and handed out again by the next Acquire().
+// Parked instances still cost X-Plane culling, so beyond max_free_ released instances are destroyed.
+class InstancePool {
+    XPLMObjectRef obj_;
+    const char **dlist_;
+    std::vector<float> park_drefs_;     // all 0, one per entry of dlist_
+    std::vector<XPLMInstanceRef> free_;
+    int max_free_;
+
+    // statistics
+    int n_created_, n_reused_, n_destroyed_, n_out_;
+
+    void Park(XPLMInstanceRef inst_ref);
+
+  public:
+    InstancePool()
+        : obj_(nullptr), dlist_(nullptr), max_free_(0), n_created_(0), n_reused_(0), n_destroyed_(0), n_out_(0) {}
+
+    // n_precreate is also the limit of parked instances
+    void Init(XPLMObjectRef obj, const char **dlist, int n_precreate);
+    void Clear(const char *name);       // destroy all instances and log statistics
+
+    XPLMInstanceRef Acquire();          // the caller must set the position
+    void Release(XPLMInstanceRef inst_ref);
+};
+
+// indexed like dgs_obj
+extern InstancePool dgs_pool[2], pole_base_pool;
+
+// The values last pushed to an instance, so a push that changes nothing can be skipped.
+// Must be invalidated whenever the instance is (re)acquired from a pool.
+struct PushCache {
+    bool valid = false;
+    XPLMDrawInfo_t drawinfo;
+    float drefs[DGS_DR_NUM];
+
+    void Invalidate() { valid = false; }
+
+    // drefs is nullptr or DGS_DR_NUM values as for dgs_dlist_dr
+    void SetPosition(XPLMInstanceRef inst_ref, const XPLMDrawInfo_t *drawinfo, const float *drefs);
+};
+
+extern int n_push, n_push_skipped;   // statistics of PushCache::SetPosition()
+#endif
@@ -43,7 +43,7 @@ void Plane::ResetBeacon() {
     beacon_on_ts_ = beacon_off_ts_ = -10.0;
 }
 
-bool Plane::BeaconOn(void) {
+bool Plane::BeaconOn(const Snapshot& snap) {
     if (use_engine_running_)
         return EnginesOn();
 
@@ -51,18 +51,17 @@ bool Plane::BeaconOn(void) {
     // to the APU generator (e.g. for the ToLiss fleet).
     // Report only state transitions if the new (off) state persisted for 3 seconds
 
-    int beacon = XPLMGetDatai(beacon_dr);
-    if (beacon) {
+    if (snap.beacon) {
         if (!beacon_last_pos_) {
-            beacon_on_ts_ = now;
+            beacon_on_ts_ = snap.now;
             beacon_last_pos_ = 1;
-        } else if (now > beacon_on_ts_ + 0.5)
+        } else if (snap.now > beacon_on_ts_ + 0.5)
             beacon_state_ = 1;
     } else {
         if (beacon_last_pos_) {
-            beacon_off_ts_ = now;
+            beacon_off_ts_ = snap.now;
             beacon_last_pos_ = 0;
-        } else if (now > beacon_off_ts_ + 3.0)
+        } else if (snap.now > beacon_off_ts_ + 3.0)
             beacon_state_ = 0;
     }
 
@@ -44,7 +44,8 @@ class Plane {
 
     void PlaneLoadedCb();               // callback for XPLM_MSG_PLANE_LOADED
     bool EnginesOn();
-    bool BeaconOn();                    // debounced state
+    bool BeaconOn(const Snapshot& snap);    // debounced state
+    bool BeaconOn() { return BeaconOn(Snapshot::Take()); }
     void ResetBeacon();                 // e.g. after a teleportation
     int PaxNo();                        // -1: n/a, >=0: # of pax
 };
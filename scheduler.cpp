@@ -0,0 +1,165 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#include <chrono>
+#include <exception>
+
+#include "autodgs.h"
+#include "scheduler.h"
+
+Scheduler scheduler;
+
+static constexpr float kNextFrame = 1.0E-3;  // s, due within means due on next frame
+
+Scheduler::Scheduler() {
+    flight_loop_id_ = nullptr;
+    wakeup_ = -1.0f;
+    in_run_ = false;
+}
+
+void Scheduler::Start() {
+    XPLMCreateFlightLoop_t ctx = {sizeof(XPLMCreateFlightLoop_t), xplm_FlightLoop_Phase_BeforeFlightModel,
+                                  FlightLoopCb, this};
+    flight_loop_id_ = XPLMCreateFlightLoop(&ctx);
+}
+
+void Scheduler::Stop() {
+    if (flight_loop_id_)
+        XPLMDestroyFlightLoop(flight_loop_id_);
+    flight_loop_id_ = nullptr;
+    LogStats();
+}
+
+int Scheduler::Add(const std::string& name, float budget, float delay, JobFn fn) {
+    int id = 0;
+    while (id < (int)jobs_.size() && jobs_[id].fn)
+        id++;
+
+    if (id == (int)jobs_.size())
+        jobs_.emplace_back();
+
+    jobs_[id] = {name, std::move(fn), budget, -1.0f, 0, 0, 0.0, 0.0f};
+    if (delay >= 0.0f)
+        Schedule(id, delay);
+    return id;
+}
+
+int Scheduler::AddPeriodic(const std::string& name, float budget, float period, std::function<void()> fn) {
+    return Add(name, budget, period, [period, fn = std::move(fn)]() {
+        fn();
+        return period;
+    });
+}
+
+void Scheduler::Remove(int id) {
+    Job& job = jobs_[id];
+    if (job.n_run > 0)
+        LogMsg("job '%s' removed: runs: %d, overruns: %d, avg: %0.3f ms, max: %0.3f ms", job.name.c_str(),
+               job.n_run, job.n_overrun, job.total_ms / job.n_run, job.max_ms);
+    job.fn = nullptr;
+    job.due = -1.0f;
+}
+
+void Scheduler::Schedule(int id, float delay) {
+    float t = XPLMGetDataf(total_running_time_sec_dr);
+    jobs_[id].due = t + std::max(delay, 0.0f);
+    Wakeup(jobs_[id].due);
+}
+
+void Scheduler::Suspend(int id) {
+    jobs_[id].due = -1.0f;
+}
+
+void Scheduler::Wakeup(float due) {
+    // when called from a job Run() takes care
+    if (flight_loop_id_ == nullptr || in_run_ || (wakeup_ >= 0.0f && wakeup_ <= due))
+        return;
+
+    wakeup_ = due;
+    float delay = due - XPLMGetDataf(total_running_time_sec_dr);
+    XPLMScheduleFlightLoop(flight_loop_id_, delay < kNextFrame ? -1.0f : delay, 1);
+}
+
+void Scheduler::LogStats() const {
+    for (auto const& job : jobs_)
+        if (job.fn && job.n_run > 0)
+            LogMsg("job '%s': runs: %d, overruns: %d, avg: %0.3f ms, max: %0.3f ms", job.name.c_str(), job.n_run,
+                   job.n_overrun, job.total_ms / job.n_run, job.max_ms);
+}
+
+float Scheduler::FlightLoopCb([[maybe_unused]] float elapsed_last_call, [[maybe_unused]] float elapsed_last_loop,
+                              [[maybe_unused]] int counter, void* ref) {
+    return static_cast<Scheduler*>(ref)->Run();
+}
+
+float Scheduler::Run() {
+    wakeup_ = -1.0f;
+    if (error_disabled)
+        return 0.0f;
+
+    now = XPLMGetDataf(total_running_time_sec_dr);
+    in_run_ = true;
+
+    try {
+        // jobs may add or remove jobs so don't hold references across calls
+        for (int i = 0; i < (int)jobs_.size(); i++) {
+            if (!jobs_[i].fn || jobs_[i].due < 0.0f || jobs_[i].due > now + kNextFrame)
+                continue;
+
+            auto t0 = std::chrono::steady_clock::now();
+            float delay = jobs_[i].fn();
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            Job& job = jobs_[i];
+            if (!job.fn)
+                continue;  // removed itself
+
+            job.n_run++;
+            job.total_ms += ms;
+            job.max_ms = std::max(job.max_ms, ms);
+            if (ms > job.budget && job.n_overrun++ == 0)
+                LogMsg("job '%s' took %0.3f ms, budget: %0.3f ms", job.name.c_str(), ms, job.budget);
+
+            if (delay == 0.0f)
+                job.due = -1.0f;
+            else
+                job.due = now + std::max(delay, 0.0f);
+        }
+    } catch (const std::exception& ex) {
+        in_run_ = false;
+        LogMsg("fatal error: '%s'", ex.what());  // hopefully LogMsg is still alive
+        LogMsg("disabling plugin to avoid further errors and hopefully protect X-Plane from crashing");
+        error_disabled = true;
+        return 0.0f;
+    }
+
+    in_run_ = false;
+
+    // sleep until the earliest job is due
+    for (auto const& job : jobs_)
+        if (job.fn && job.due >= 0.0f && (wakeup_ < 0.0f || job.due < wakeup_))
+            wakeup_ = job.due;
+
+    if (wakeup_ < 0.0f)
+        return 0.0f;
+
+    return (wakeup_ - now < kNextFrame) ? -1.0f : wakeup_ - now;
+}
@@ -0,0 +1,81 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "XPLMProcessing.h"
+
+// Runs the periodic jobs of the plugin on top of a single XPLM flight loop.
+// The flight loop only wakes up when the earliest job is due.
+// With a handful of jobs a linear scan for the earliest one is cheaper than any fancy structure.
+class Scheduler {
+  public:
+    // a job returns the delay to its next run as a flight loop does:
+    // > 0: seconds, < 0: next frame, 0: suspended until Schedule() is called
+    typedef std::function<float()> JobFn;
+
+  private:
+    struct Job {
+        std::string name;
+        JobFn fn;               // empty: slot is free
+        float budget;           // ms, a run above is counted as overrun
+        float due;              // next run, < 0: suspended
+
+        // statistics
+        int n_run, n_overrun;
+        double total_ms;
+        float max_ms;
+    };
+
+    std::deque<Job> jobs_;      // a deque so adding jobs from within a running job is safe
+    XPLMFlightLoopID flight_loop_id_;
+    float wakeup_;              // the flight loop is scheduled for, < 0: not scheduled
+    bool in_run_;
+
+    static float FlightLoopCb(float elapsed_last_call, float elapsed_last_loop, int counter, void *ref);
+    float Run();
+    void Wakeup(float due);     // make sure the flight loop runs no later than due
+
+  public:
+    Scheduler();
+    void Start();
+    void Stop();
+
+    // add a job that runs first after delay (< 0: suspended) and then as its return value says, -> job id
+    int Add(const std::string& name, float budget, float delay, JobFn fn);
+
+    // add a job with a fixed period
+    int AddPeriodic(const std::string& name, float budget, float period, std::function<void()> fn);
+
+    void Remove(int id);
+    void Schedule(int id, float delay);     // next run in delay seconds, 0: next frame
+    void Suspend(int id);
+    void LogStats() const;
+};
+
+extern Scheduler scheduler;
+
+#endif
@@ -0,0 +1,202 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+// The capture test of FindNearestStand as a batch kernel over stands in SoA layout.
+// It is free of XPLM dependencies so it can be tested and benchmarked standalone.
+
+#ifndef _STAND_CAPTURE_H_
+#define _STAND_CAPTURE_H_
+
+#include <new>
+#include <vector>
+
+#include "flat_earth_math.h"
+
+namespace stand_capture {
+
+namespace fem = flat_earth_math;
+
+template <typename T, size_t kAlign = 64>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, kAlign>&) {}
+
+    template <typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, kAlign> other;
+    };
+
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(kAlign))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(kAlign)); }
+
+    bool operator==(const AlignedAllocator&) const { return true; }
+};
+
+typedef std::vector<float, AlignedAllocator<float>> FloatArray;
+
+#ifdef FEM_SIMD
+typedef fem::batch::Simd<float> S;
+static constexpr int kLanes = S::kLanes;
+#else
+static constexpr int kLanes = 1;
+#endif
+
+// stand data for the capture test
+// the arrays are padded with kLanes invalid entries so the kernel can read full vectors beyond the end
+struct StandSoA {
+    FloatArray x, z;                  // local frame
+    FloatArray hdgt, sin_hdgt, cos_hdgt;
+    FloatArray valid;                 // 1.0 or 0.0 (e.g. is_wet)
+
+    void Resize(int n) {
+        for (auto a : {&x, &z, &hdgt, &sin_hdgt, &cos_hdgt})
+            a->assign(n + kLanes, 0.0f);
+        valid.assign(n + kLanes, 0.0f);
+    }
+
+    void Set(int i, float x_, float z_, float hdgt_, float sin_hdgt_, float cos_hdgt_, bool valid_) {
+        x[i] = x_;
+        z[i] = z_;
+        hdgt[i] = hdgt_;
+        sin_hdgt[i] = sin_hdgt_;
+        cos_hdgt[i] = cos_hdgt_;
+        valid[i] = valid_;
+    }
+
+    // this = the entries idx of src
+    void Gather(const StandSoA& src, const std::vector<int>& idx) {
+        Resize(idx.size());
+        for (int i = 0; i < (int)idx.size(); i++) {
+            int j = idx[i];
+            Set(i, src.x[j], src.z[j], src.hdgt[j], src.sin_hdgt[j], src.cos_hdgt[j], src.valid[j] > 0.5f);
+        }
+    }
+};
+
+struct Input {
+    float plane_x, plane_z, plane_hdgt;
+    float nw_z;                         // plane's 0 to nose wheel
+    float max_dist;                     // fast exit distance of the nose wheel
+};
+
+static constexpr float kReject = 1.0E10f;
+static constexpr float kD2R = 0.0174532925f;
+
+// sin(x) for x in [-pi/2, pi/2], error < 4E-6
+template <typename V>
+static inline V SinPoly(V x) {
+    V x2 = x * x;
+    return x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f)))));
+}
+
+// atan(t) in degrees, |t| <= 1 with polynomial, beyond via pi/2 - atan(1/t), error < 1E-3°
+template <typename V>
+static inline V AtanDeg(V t) {
+    auto big = (t > 1.0f) | (t < -1.0f);
+    V u = big ? 1.0f / t : t;
+    V u2 = u * u;
+    V a = u * (0.99997726f +
+               u2 * (-0.33262347f + u2 * (0.19354346f + u2 * (-0.11643287f + u2 * (0.05265332f + u2 * -0.01172120f)))));
+    V sign = t >= 0.0f ? V{} + 1.0f : V{} - 1.0f;
+    a = big ? sign * 1.5707963f - a : a;
+    return a * (1.0f / kD2R);
+}
+
+// weighted distance of the nose wheel to the stand or kReject, V is float or a vector of float
+template <typename V>
+static inline V Dist(V x, V z, V hdgt, V sin_hdgt, V cos_hdgt, V valid, const Input& in) {
+    // heading in local system
+    V local_hdgt = fem::batch::RA<float, V>(in.plane_hdgt - hdgt);
+    V abs_hdgt = local_hdgt >= 0.0f ? local_hdgt : -local_hdgt;
+    auto ok = (valid > 0.5f) & (abs_hdgt <= 90.0f);  // looking to stand
+
+    // xlate + rotate into stand frame
+    V dx = in.plane_x - x;
+    V dz = in.plane_z - z;
+    V local_x = cos_hdgt * dx + sin_hdgt * dz;
+    V local_z = -sin_hdgt * dx + cos_hdgt * dz;
+
+    // nose wheel
+    V nw_z = local_z - in.nw_z;
+    V nw_x = local_x + in.nw_z * SinPoly(kD2R * local_hdgt);
+
+    ok = ok & (nw_x * nw_x + nw_z * nw_z <= in.max_dist * in.max_dist);  // fast exit
+    ok = ok & (nw_z >= -4.0f);                                              // behind
+
+    // plane in a +-60° sector relative to stand and no drive-by beyond a +- 60° sector relative to plane's direction
+    auto far = nw_z > 10.0f;
+    V angle = AtanDeg(nw_x / (far ? nw_z : V{} + 1.0f));
+    V abs_angle = angle >= 0.0f ? angle : -angle;
+    V rel_to_stand = -angle - local_hdgt;  // |angle| <= 60, |local_hdgt| <= 90 -> no RA required
+    auto drive_by = ((nw_x > 10.0f) & (rel_to_stand < -60.0f)) | ((nw_x < -10.0f) & (rel_to_stand > 60.0f));
+    ok = ok & ((far == 0) | ((abs_angle <= 60.0f) & (drive_by == 0)));
+
+    // for the final comparison give xtrack a higher weight + consider heading deviation
+    static constexpr float xtrack_weight = 4.0;
+    V d = fem::batch::Sqrt(xtrack_weight * xtrack_weight * nw_x * nw_x + nw_z * nw_z) + abs_hdgt;
+    return ok ? d : V{} + kReject;
+}
+
+// Run the capture test for stands [begin, end) of soa and update best_d, best_i with the minimum.
+// Entries up to begin + kLanes beyond end may be evaluated as well which does not harm as they are
+// either real stands or invalid padding.
+static inline void FindMin(const StandSoA& soa, int begin, int end, const Input& in, float& best_d, int& best_i) {
+#ifdef FEM_SIMD
+    typedef S::V V;
+    typedef int VI __attribute__((vector_size(sizeof(V))));
+
+    V vbest_d = V{} + best_d;
+    VI vbest_i = VI{} + best_i;
+    VI idx;
+    for (int k = 0; k < kLanes; k++)
+        idx[k] = begin + k;
+
+    for (int i = begin; i < end; i += kLanes) {
+        V d = Dist(S::Load(&soa.x[i]), S::Load(&soa.z[i]), S::Load(&soa.hdgt[i]), S::Load(&soa.sin_hdgt[i]),
+                   S::Load(&soa.cos_hdgt[i]), S::Load(&soa.valid[i]), in);
+        auto m = d < vbest_d;
+        vbest_d = m ? d : vbest_d;
+        vbest_i = m ? idx : vbest_i;
+        idx += kLanes;
+    }
+
+    // horizontal reduction, on a tie the lower index wins
+    for (int k = 0; k < kLanes; k++)
+        if (vbest_d[k] < best_d || (vbest_d[k] == best_d && vbest_i[k] < best_i)) {
+            best_d = vbest_d[k];
+            best_i = vbest_i[k];
+        }
+#else
+    for (int i = begin; i < end; i++) {
+        float d = Dist<float>(soa.x[i], soa.z[i], soa.hdgt[i], soa.sin_hdgt[i], soa.cos_hdgt[i], soa.valid[i], in);
+        if (d < best_d) {
+            best_d = d;
+            best_i = i;
+        }
+    }
+#endif
+}
+
+}  // namespace stand_capture
+#endif
@@ -0,0 +1,220 @@
+//
+//    Correctness test and microbenchmark for the stand capture kernel
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "stand_capture.h"
+
+namespace sc = stand_capture;
+namespace fem = flat_earth_math;
+
+static constexpr float kD2R = 0.0174532925f;
+#define SQR(x) ((x) * (x))
+
+struct RefStand {
+    float x, z, hdgt, sin_hdgt, cos_hdgt;
+    bool is_wet;
+};
+
+// the scalar capture test as it was in Airport::FindNearestStand
+static float RefDist(const RefStand& s, const sc::Input& in) {
+    if (s.is_wet)
+        return sc::kReject;
+
+    float local_hdgt = fem::RA(in.plane_hdgt - s.hdgt);
+    if (fabsf(local_hdgt) > 90.0f)
+        return sc::kReject;
+
+    float dx = in.plane_x - s.x;
+    float dz = in.plane_z - s.z;
+    float local_x = s.cos_hdgt * dx + s.sin_hdgt * dz;
+    float local_z = -s.sin_hdgt * dx + s.cos_hdgt * dz;
+
+    float nw_z = local_z - in.nw_z;
+    float nw_x = local_x + in.nw_z * sinf(kD2R * local_hdgt);
+
+    float d = sqrt(SQR(nw_x) + SQR(nw_z));
+    if (d > in.max_dist)
+        return sc::kReject;
+
+    if (nw_z < -4.0)
+        return sc::kReject;
+
+    if (nw_z > 10.0) {
+        float angle = atan(nw_x / nw_z) / kD2R;
+        if (fabsf(angle) > 60.0)
+            return sc::kReject;
+
+        float rel_to_stand = fem::RA(-angle - local_hdgt);
+        if ((nw_x > 10.0 && rel_to_stand < -60.0) || (nw_x < -10.0 && rel_to_stand > 60.0))
+            return sc::kReject;
+    }
+
+    static constexpr float xtrack_weight = 4.0;
+    return sqrt(SQR(xtrack_weight * nw_x) + SQR(nw_z)) + fabsf(local_hdgt);
+}
+
+// the geometry embedded in a larger object, like it is in Airport::Stand with its rendering state
+struct FatStand {
+    RefStand s;
+    char cold[240];
+};
+
+template <typename T>
+static const RefStand& Geo(const T& s) {
+    if constexpr (std::is_same_v<T, FatStand>)
+        return s.s;
+    else
+        return s;
+}
+
+template <typename T>
+static int RefFindMin(const std::vector<T>& stands, const sc::Input& in, float& best_d) {
+    int best_i = -1;
+    best_d = sc::kReject;
+    for (int i = 0; i < (int)stands.size(); i++) {
+        float d = RefDist(Geo(stands[i]), in);
+        if (d < best_d) {
+            best_d = d;
+            best_i = i;
+        }
+    }
+    return best_i;
+}
+
+// synthetic airport: kN stands in aprons of 20 stands along taxiways
+static void MakeAirport(int n, std::vector<RefStand>& stands, sc::StandSoA& soa) {
+    std::mt19937 gen(4711);
+    std::uniform_real_distribution<float> jitter(-2.0f, 2.0f);
+    stands.resize(n);
+    soa.Resize(n);
+    for (int i = 0; i < n; i++) {
+        int apron = i / 20;
+        RefStand& s = stands[i];
+        s.x = (apron % 8) * 400.0f + (i % 20) * 45.0f + jitter(gen);
+        s.z = (apron / 8) * 300.0f + jitter(gen);
+        s.hdgt = fem::RA((apron % 4) * 90.0f + 5.0f * jitter(gen));
+        s.sin_hdgt = sinf(kD2R * s.hdgt);
+        s.cos_hdgt = cosf(kD2R * s.hdgt);
+        s.is_wet = (i % 97 == 0);
+        soa.Set(i, s.x, s.z, s.hdgt, s.sin_hdgt, s.cos_hdgt, !s.is_wet);
+    }
+}
+
+static std::vector<sc::Input> MakeInputs(const std::vector<RefStand>& stands, int n) {
+    std::mt19937 gen(815);
+    std::uniform_int_distribution<int> pick(0, stands.size() - 1);
+    std::uniform_real_distribution<float> d(-80.0f, 80.0f);
+    std::uniform_real_distribution<float> h(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> nw(5.0f, 30.0f);
+
+    // positions in front of random stands and looking roughly to them
+    std::vector<sc::Input> in(n);
+    for (auto& i : in) {
+        const RefStand& s = stands[pick(gen)];
+        float f = 20.0f + 60.0f * (d(gen) + 80.0f) / 160.0f;  // distance in front of stand
+        i.plane_x = s.x - s.sin_hdgt * f + 0.3f * d(gen);
+        i.plane_z = s.z + s.cos_hdgt * f + 0.3f * d(gen);
+        i.plane_hdgt = fem::RA(s.hdgt + h(gen));
+        i.nw_z = nw(gen);
+        i.max_dist = 80.0f;
+    }
+    return in;
+}
+
+int main() {
+    static constexpr int kN = 1000;
+    static constexpr int kNIn = 20000;
+
+    std::vector<RefStand> stands;
+    sc::StandSoA soa;
+    MakeAirport(kN, stands, soa);
+    auto inputs = MakeInputs(stands, kNIn);
+
+    printf("stand capture test, %d stands, %d lanes\n", kN, sc::kLanes);
+
+    // Both versions must choose the same stand. The kernel uses polynomial approximations so on
+    // (near) ties or right at a sector border a different choice is acceptable.
+    int n_found = 0, n_diff = 0, n_fail = 0;
+    for (auto& in : inputs) {
+        float ref_d;
+        int ref_i = RefFindMin(stands, in, ref_d);
+
+        float d = sc::kReject;
+        int i = -1;
+        sc::FindMin(soa, 0, kN, in, d, i);
+
+        n_found += (ref_i >= 0);
+        if (i == ref_i)
+            continue;
+
+        n_diff++;
+        float ref_d_i = (i >= 0) ? RefDist(stands[i], in) : sc::kReject;
+        if (fabsf(ref_d_i - ref_d) > 0.05f && fabsf(d - ref_d) > 0.05f) {
+            printf("mismatch: ref: %d %0.3f, kernel: %d %0.3f\n", ref_i, ref_d, i, d);
+            n_fail++;
+        }
+    }
+
+    printf("%d inputs, %d with a stand found, %d different but acceptable choices\n", kNIn, n_found,
+           n_diff - n_fail);
+
+    // benchmark a full scan over all stands, with the geometry embedded in fat objects, compact and as SoA
+    std::vector<FatStand> fat_stands(kN);
+    for (int i = 0; i < kN; i++)
+        fat_stands[i].s = stands[i];
+
+    volatile int sink = 0;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (auto& in : inputs) {
+        float d;
+        sink = RefFindMin(fat_stands, in, d);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (auto& in : inputs) {
+        float d;
+        sink = RefFindMin(stands, in, d);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (auto& in : inputs) {
+        float d = sc::kReject;
+        int i = -1;
+        sc::FindMin(soa, 0, kN, in, d, i);
+        sink = i;
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+    (void)sink;
+
+    double t_f = std::chrono::duration<double>(t1 - t0).count() / kNIn * 1.0E6;
+    double t_s = std::chrono::duration<double>(t2 - t1).count() / kNIn * 1.0E6;
+    double t_b = std::chrono::duration<double>(t3 - t2).count() / kNIn * 1.0E6;
+    printf("\nBenchmark, µs per scan of %d stands (M stands/s)\n", kN);
+    printf("scalar %d byte objects: %8.2f (%6.1f)\n", (int)sizeof(FatStand), t_f, kN / t_f);
+    printf("scalar compact:          %8.2f (%6.1f)\n", t_s, kN / t_s);
+    printf("kernel:                  %8.2f (%6.1f), speedup: %4.1f\n", t_b, kN / t_b, t_f / t_b);
+
+    printf("\n%s, %d failures\n", n_fail ? "FAILED" : "PASSED", n_fail);
+    return n_fail ? 1 : 0;
+}
@@ -0,0 +1,434 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <tuple>
+
+#if IBM
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "autodgs.h"
+#include "file_writer.h"
+#include "stand_cfg_store.h"
+
+namespace fs = std::filesystem;
+
+StandCfgStore stand_cfg_store;
+
+// Layout of the index file, native byte order as it never leaves the machine:
+// Header, IndexEntry[n_airports] sorted by key, Record[n_records], names
+static constexpr char kMagic[8] = {'A', 'D', 'G', 'S', 'C', 'F', 'G', '1'};
+
+struct StandCfgStore::Header {
+    char magic[8];
+    uint64_t stamp;             // of the imported .cfg files
+    uint32_t n_airports, n_records, names_size, reserved;
+};
+
+struct StandCfgStore::IndexEntry {
+    uint64_t key;               // packed ICAO
+    uint32_t first, count;      // into the records
+};
+
+struct StandCfgStore::Record {
+    float dgs_dist;
+    uint32_t name_ofs;          // into the names
+    uint16_t name_len;
+    uint8_t dgs_type, reserved;
+};
+
+// the ICAO as big endian number so the keys sort like the names, 0: does not fit
+static uint64_t PackIcao(std::string_view icao) {
+    if (icao.empty() || icao.size() > 8)
+        return 0;
+
+    uint64_t key = 0;
+    for (int i = 0; i < 8; i++)
+        key = (key << 8) | (i < (int)icao.size() ? (uint8_t)icao[i] : 0);
+    return key;
+}
+
+static std::string UnpackIcao(uint64_t key) {
+    std::string icao;
+    for (int i = 0; i < 8; i++)
+        if (char c = (char)(key >> (56 - 8 * i)))
+            icao += c;
+    return icao;
+}
+
+StandCfgStore::StandCfgStore()
+    : map_(nullptr), map_size_(0), hdr_(nullptr), index_(nullptr), records_(nullptr), names_(nullptr) {}
+
+// -> # of valid lines
+int StandCfgStore::ParseCfg(const std::string& pathname, std::vector<StandCfg>& cfg) {
+    int n_valid = 0;
+    std::ifstream f(pathname);
+    if (f.is_open()) {
+        LogMsg("Loading config from '%s'", pathname.c_str());
+
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.size() == 0 || line[0] == '#')
+                continue;
+
+            if (line.back() == '\r')
+                line.pop_back();
+
+            int ofs;
+            float dgs_dist;
+            char type;
+            int n = sscanf(line.c_str(), "%c,%f, %n", &type, &dgs_dist, &ofs);
+            if (n != 2 || ofs >= (int)line.size()  // distrust user input
+                || !(type == 'V' || type == 'M') || dgs_dist < kDgsMinDist || dgs_dist > kDgsMaxDist) {
+                LogMsg("invalid line: '%s' %d", line.c_str(), n);
+                continue;
+            }
+
+            n_valid++;
+            cfg.push_back({type == 'M' ? kMarshaller : kVDGS, dgs_dist, line.substr(ofs)});
+        }
+    }
+
+    return n_valid;
+}
+
+// all .cfg files in cfg_dirs_, sorted by dir and icao
+std::vector<StandCfgStore::CfgFile> StandCfgStore::ScanCfgFiles() const {
+    std::vector<CfgFile> files;
+    for (int d = 0; d < (int)cfg_dirs_.size(); d++) {
+        std::error_code ec;
+        for (auto const& de : fs::directory_iterator(cfg_dirs_[d], ec)) {
+            if (!de.is_regular_file(ec) || de.path().extension() != ".cfg")
+                continue;
+
+            uint64_t size = fs::file_size(de.path(), ec);
+            int64_t mtime = fs::last_write_time(de.path(), ec).time_since_epoch().count();
+            files.push_back({d, de.path().stem().string(), de.path().string(), size, mtime});
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// FNV-1a over name, size and modification time of the files
+uint64_t StandCfgStore::Stamp(const std::vector<CfgFile>& files) {
+    uint64_t stamp = 0xcbf29ce484222325ULL;
+    auto hash = [&stamp](const void* p, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            stamp ^= static_cast<const uint8_t*>(p)[i];
+            stamp *= 0x100000001b3ULL;
+        }
+    };
+
+    for (auto const& f : files) {
+        hash(&f.dir, sizeof(f.dir));
+        hash(f.icao.data(), f.icao.size());
+        hash(&f.size, sizeof(f.size));
+        hash(&f.mtime, sizeof(f.mtime));
+    }
+
+    return stamp;
+}
+
+void StandCfgStore::Open(const std::string& index_path, const std::vector<std::string>& cfg_dirs) {
+    Unmap();
+    overlay_.clear();
+    unindexed_.clear();
+    index_path_ = index_path;
+    cfg_dirs_ = cfg_dirs;
+    files_ = ScanCfgFiles();
+
+    // an airport's entries come from the first directory that has valid lines for it
+    for (auto const& f : files_) {
+        if (PackIcao(f.icao) != 0)
+            continue;
+
+        LogMsg("'%s' is not indexed and kept in memory", f.path.c_str());
+        auto& cfg = unindexed_[f.icao];
+        if (cfg.empty())    // else a higher priority directory has it
+            ParseCfg(f.path, cfg);
+    }
+
+    uint64_t stamp = Stamp(files_);
+    if (Map(stamp))
+        return;
+
+    // import
+    std::map<uint64_t, std::vector<StandCfg>> airports;
+    for (auto const& f : files_) {
+        uint64_t key = PackIcao(f.icao);
+        if (key == 0)
+            continue;
+
+        auto& cfg = airports[key];
+        if (cfg.empty())
+            ParseCfg(f.path, cfg);
+    }
+
+    if (WriteIndex(stamp, airports) && Map(stamp)) {
+        LogMsg("Stand config index '%s' built from %d files", index_path_.c_str(), (int)files_.size());
+        return;
+    }
+
+    for (auto& [key, cfg] : airports)
+        if (!cfg.empty())
+            unindexed_[UnpackIcao(key)] = std::move(cfg);
+}
+
+// write the index to a temp file and rename so an interrupted write never leaves a broken index
+bool StandCfgStore::WriteIndex(uint64_t stamp, const std::map<uint64_t, std::vector<StandCfg>>& airports) {
+    std::vector<IndexEntry> index;
+    std::vector<Record> records;
+    std::string names;
+    index.reserve(airports.size());
+
+    for (auto const& [key, cfg] : airports) {
+        if (cfg.empty())
+            continue;
+
+        index.push_back({key, (uint32_t)records.size(), (uint32_t)cfg.size()});
+        for (auto const& c : cfg) {
+            records.push_back({c.dgs_dist, (uint32_t)names.size(), (uint16_t)c.name.size(), (uint8_t)c.dgs_type, 0});
+            names += c.name;
+        }
+    }
+
+    Header hdr{};
+    memcpy(hdr.magic, kMagic, sizeof(kMagic));
+    hdr.stamp = stamp;
+    hdr.n_airports = index.size();
+    hdr.n_records = records.size();
+    hdr.names_size = names.size();
+
+    std::string tmp_path = index_path_ + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) {
+            LogMsg("Can't create '%s', .cfg entries are kept in memory", tmp_path.c_str());
+            return false;
+        }
+
+        f.write((const char*)&hdr, sizeof(hdr));
+        f.write((const char*)index.data(), index.size() * sizeof(IndexEntry));
+        f.write((const char*)records.data(), records.size() * sizeof(Record));
+        f.write(names.data(), names.size());
+        if (!f.good()) {
+            LogMsg("Error writing '%s', .cfg entries are kept in memory", tmp_path.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, index_path_, ec);
+    if (ec) {
+        LogMsg("Can't rename '%s': %s", tmp_path.c_str(), ec.message().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// map the index file if it is valid and up to date, -> success
+bool StandCfgStore::Map(uint64_t stamp) {
+    const std::string& path = index_path_;
+#if IBM
+    HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+    if (fh == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE mh = NULL;
+    if (GetFileSizeEx(fh, &size) && size.QuadPart > 0) {
+        map_size_ = size.QuadPart;
+        mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+
+    // the view keeps the mapping alive
+    if (mh) {
+        map_ = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mh);
+    }
+    CloseHandle(fh);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map_size_ = st.st_size;
+        map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map_ == MAP_FAILED)
+            map_ = nullptr;
+    }
+    close(fd);
+#endif
+
+    if (map_ == nullptr)
+        return false;
+
+    // distrust the file
+    hdr_ = (const Header*)map_;
+    bool ok = map_size_ >= sizeof(Header) && memcmp(hdr_->magic, kMagic, sizeof(kMagic)) == 0 &&
+              map_size_ == sizeof(Header) + (uint64_t)hdr_->n_airports * sizeof(IndexEntry) +
+                               (uint64_t)hdr_->n_records * sizeof(Record) + hdr_->names_size;
+
+    if (ok) {
+        index_ = (const IndexEntry*)(hdr_ + 1);
+        records_ = (const Record*)(index_ + hdr_->n_airports);
+        names_ = (const char*)(records_ + hdr_->n_records);
+
+        for (uint32_t i = 0; ok && i < hdr_->n_airports; i++)
+            ok = (uint64_t)index_[i].first + index_[i].count <= hdr_->n_records &&
+                 (i == 0 || index_[i - 1].key < index_[i].key);
+        for (uint32_t i = 0; ok && i < hdr_->n_records; i++)
+            ok = (uint64_t)records_[i].name_ofs + records_[i].name_len <= hdr_->names_size;
+    }
+
+    if (!ok) {
+        LogMsg("Stand config index '%s' is invalid", path.c_str());
+        Unmap();
+        return false;
+    }
+
+    if (hdr_->stamp != stamp) {
+        Unmap();
+        return false;
+    }
+
+    LogMsg("Stand config index '%s' mapped, %d airports", path.c_str(), (int)hdr_->n_airports);
+    return true;
+}
+
+void StandCfgStore::Unmap() {
+    if (map_) {
+#if IBM
+        UnmapViewOfFile(map_);
+#else
+        munmap(map_, map_size_);
+#endif
+    }
+
+    map_ = nullptr;
+    map_size_ = 0;
+    hdr_ = nullptr;
+    index_ = nullptr;
+    records_ = nullptr;
+    names_ = nullptr;
+}
+
+// Merge the files written in this session into the index so the next Open() can use it as is.
+// If any other .cfg file changed in the meantime the index stays outdated and Open() rebuilds it.
+void StandCfgStore::Close() {
+    assert(!file_writer.running());     // the .cfg files of the overlay must be on disk before they are stamped
+    if (!overlay_.empty() && hdr_) {
+        std::vector<CfgFile> files = ScanCfgFiles();
+
+        // the files of the overlay are in the highest priority directory
+        auto written = [this](const CfgFile& f) { return f.dir == 0 && overlay_.count(f.icao); };
+        std::vector<CfgFile> others, others_now;
+        std::copy_if(files_.begin(), files_.end(), std::back_inserter(others), [&](auto& f) { return !written(f); });
+        std::copy_if(files.begin(), files.end(), std::back_inserter(others_now), [&](auto& f) { return !written(f); });
+
+        auto same = [](const CfgFile& a, const CfgFile& b) {
+            return a.dir == b.dir && a.icao == b.icao && a.size == b.size && a.mtime == b.mtime;
+        };
+
+        if (std::equal(others.begin(), others.end(), others_now.begin(), others_now.end(), same)) {
+            std::map<uint64_t, std::vector<StandCfg>> airports;
+            for (uint32_t i = 0; i < hdr_->n_airports; i++) {
+                auto& cfg = airports[index_[i].key];
+                for (uint32_t k = index_[i].first; k < index_[i].first + index_[i].count; k++) {
+                    const Record& r = records_[k];
+                    cfg.push_back({r.dgs_type, r.dgs_dist, std::string(names_ + r.name_ofs, r.name_len)});
+                }
+            }
+
+            for (auto const& [icao, cfg] : overlay_)
+                if (uint64_t key = PackIcao(icao))
+                    airports[key] = cfg;
+
+            uint64_t stamp = Stamp(files);
+            Unmap();
+            if (WriteIndex(stamp, airports))
+                LogMsg("Stand config index '%s' updated for %d airports", index_path_.c_str(), (int)overlay_.size());
+        } else
+            LogMsg("other .cfg files changed, stand config index is rebuilt on next start");
+    }
+
+    Unmap();
+    overlay_.clear();
+    unindexed_.clear();
+}
+
+int StandCfgStore::Lookup(const std::string& icao, std::vector<StandCfg>& cfg) const {
+    cfg.clear();
+
+    auto it = overlay_.find(icao);
+    if (it != overlay_.end()) {
+        cfg = it->second;
+        return cfg.size();
+    }
+
+    it = unindexed_.find(icao);
+    if (it != unindexed_.end()) {
+        cfg = it->second;
+        return cfg.size();
+    }
+
+    // files added during the session are picked up by the next Open()
+    uint64_t key = PackIcao(icao);
+    if (key == 0 || hdr_ == nullptr)
+        return 0;
+
+    const IndexEntry* end = index_ + hdr_->n_airports;
+    const IndexEntry* e =
+        std::lower_bound(index_, end, key, [](const IndexEntry& e, uint64_t key) { return e.key < key; });
+    if (e == end || e->key != key)
+        return 0;
+
+    cfg.reserve(e->count);
+    for (uint32_t i = e->first; i < e->first + e->count; i++) {
+        const Record& r = records_[i];
+        cfg.push_back({r.dgs_type, r.dgs_dist, std::string(names_ + r.name_ofs, r.name_len)});
+    }
+
+    return cfg.size();
+}
+
+void StandCfgStore::Update(const std::string& icao, const std::vector<StandCfg>& cfg) {
+    overlay_[icao] = cfg;
+}
@@ -0,0 +1,100 @@
+//
+//    AutoDGS: Show Marshaller or VDGS at default airports
+//
+//    Copyright (C) 2025  Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#ifndef _STAND_CFG_STORE_H_
+#define _STAND_CFG_STORE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// one line of a <ICAO>.cfg file
+struct StandCfg {
+    int dgs_type;           // kMarshaller or kVDGS
+    float dgs_dist;
+    std::string name;       // stand name
+};
+
+// The per airport .cfg files of the user and system config directories remain the editable
+// and exchangeable format. They are imported into a single index file keyed by the packed ICAO
+// that is memory mapped, so loading an airport's overrides is a lookup.
+// The index is rebuilt at Open() whenever a .cfg file was added, removed or changed outside of the plugin.
+// Files written by the plugin are merged into the index at Close().
+class StandCfgStore {
+    struct Header;
+    struct IndexEntry;
+    struct Record;
+
+    struct CfgFile {
+        int dir;                // index into cfg_dirs_
+        std::string icao, path;
+        uint64_t size;
+        int64_t mtime;
+        bool operator<(const CfgFile& b) const { return std::tie(dir, icao) < std::tie(b.dir, b.icao); }
+    };
+
+    void *map_;             // the mapped index file or nullptr
+    size_t map_size_;
+
+    const Header *hdr_;
+    const IndexEntry *index_;
+    const Record *records_;
+    const char *names_;
+
+    // files written during this session, merged into the index at Close()
+    std::unordered_map<std::string, std::vector<StandCfg>> overlay_;
+
+    // airports that can't go into the index, read at Open()
+    std::unordered_map<std::string, std::vector<StandCfg>> unindexed_;
+
+    std::string index_path_;
+    std::vector<std::string> cfg_dirs_;     // in priority order
+    std::vector<CfgFile> files_;            // as of Open()
+
+    std::vector<CfgFile> ScanCfgFiles() const;
+    static uint64_t Stamp(const std::vector<CfgFile>& files);
+    bool WriteIndex(uint64_t stamp, const std::map<uint64_t, std::vector<StandCfg>>& airports);
+    bool Map(uint64_t stamp);
+    void Unmap();
+
+  public:
+    StandCfgStore();
+    ~StandCfgStore() { Unmap(); }
+
+    // cfg_dirs in priority order, the first directory that has valid entries for an airport wins
+    void Open(const std::string& index_path, const std::vector<std::string>& cfg_dirs);
+    void Close();   // after the file writer is stopped, see XPluginStop()
+
+    // cfg = the entries of icao, -> # of entries
+    int Lookup(const std::string& icao, std::vector<StandCfg>& cfg) const;
+
+    // cfg was just written to the highest priority directory
+    void Update(const std::string& icao, const std::vector<StandCfg>& cfg);
+
+    // parse a .cfg file, -> # of valid lines
+    static int ParseCfg(const std::string& pathname, std::vector<StandCfg>& cfg);
+};
+
+extern StandCfgStore stand_cfg_store;
+#endif